@@ -0,0 +1,103 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "memory_stats.h"
+
+// Bump allocator: hands out memory from big blocks and frees everything at
+// once with reset(). Blocks are kept between resets, so after warming up
+// allocating is a pointer bump and never touches the global heap.
+// Only for trivially destructible types, nothing gets destructed.
+class Arena {
+private:
+    std::vector<std::unique_ptr<uint8_t[]>> blocks;
+    std::vector<size_t> blockSizes;
+    size_t blockSize;
+    size_t currentBlock = 0;
+    size_t offset = 0;
+    size_t bytesUsed = 0;
+    size_t peakBytes = 0;
+    uint64_t allocations = 0;
+
+    void* allocateSlow(size_t size, size_t align) {
+        // Next kept block that fits, otherwise a new one
+        for (++currentBlock; currentBlock < blocks.size(); ++currentBlock) {
+            if (blockSizes[currentBlock] >= size + align) {
+                break;
+            }
+        }
+        if (currentBlock >= blocks.size()) {
+            const size_t newSize = (size + align > blockSize) ? size + align : blockSize;
+            blocks.emplace_back(new uint8_t[newSize]);
+            blockSizes.push_back(newSize);
+            currentBlock = blocks.size() - 1;
+        }
+        offset = 0;
+        return allocate(size, align);
+    }
+
+public:
+    explicit Arena(size_t blockSize = 64 * 1024) : blockSize(blockSize) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena(Arena&&) = default;
+    Arena& operator=(Arena&&) = default;
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        if (!blocks.empty()) {
+            const uintptr_t base = reinterpret_cast<uintptr_t>(blocks[currentBlock].get());
+            const uintptr_t start = (base + offset + align - 1) & ~uintptr_t(align - 1);
+            if (start + size <= base + blockSizes[currentBlock]) {
+                offset = start + size - base;
+                bytesUsed += size;
+                peakBytes = bytesUsed > peakBytes ? bytesUsed : peakBytes;
+                ++allocations;
+                return reinterpret_cast<void*>(start);
+            }
+        }
+        return allocateSlow(size, align);
+    }
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena never runs destructors");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    T* allocateArray(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena never runs destructors");
+        T* array = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        for (size_t i = 0; i < count; ++i) {
+            new (&array[i]) T();
+        }
+        return array;
+    }
+
+    // Free everything, keep the blocks for next time
+    void reset() {
+        currentBlock = 0;
+        offset = 0;
+        bytesUsed = 0;
+    }
+
+    size_t getBytesUsed() const { return bytesUsed; }
+    size_t getBlockCount() const { return blocks.size(); }
+    size_t getCapacity() const {
+        size_t total = 0;
+        for (size_t size : blockSizes) {
+            total += size;
+        }
+        return total;
+    }
+
+    MemoryStats getStats() const {
+        return { bytesUsed, getCapacity(), peakBytes, allocations };
+    }
+};
@@ -8,22 +8,18 @@ enum CellType {
 }; 
 
 struct GridCell {
-    // Cell coordinates on screen for the base viewport
-    // represents the to point of the cell
-    float x; 
-    float y;
+    // Where the cell is comes from its index in the grid ([row][col] on the
+    // isometric lattice), the cell itself has no screen data
     CellType cellType;
-    bool occupied = false; // is there a character on it?
+    // is there a character on it? Only read/written with the map file,
+    // who stands where during a battle is tracked by Sim::Occupancy
+    bool occupied = false;
     
     GridCell(){
-      this->x = 0;
-      this->y = 0;
       this->occupied = false;
       this->cellType = NO_RENDER;
     }
-    GridCell(float x, float y, CellType celltype, bool occupied){
-      this->x = x;
-      this->y = y;
+    GridCell(CellType celltype, bool occupied){
       this->occupied = occupied;
       this->cellType = celltype;
     }
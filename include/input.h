@@ -0,0 +1,73 @@
+#pragma once
+#include <SDL2/SDL.h>
+
+#include <vector>
+
+#include "arena.h"
+
+// Max commands kept per frame, whatever doesn't fit stays in SDL's queue
+// for the next frame
+const size_t MAX_FRAME_COMMANDS = 128;
+
+// What the game reacts to, SDL events get mapped to these through the
+// binding table
+enum Command {
+    NO_COMMAND,
+    QUIT_GAME,
+    POINTER_MOVED,
+    TOGGLE_FULLSCREEN,
+    TOGGLE_EDITOR,
+    BRUSH_WALKABLE,
+    BRUSH_OBSTACLE,
+    BRUSH_EMPTY,
+    UNDO_EDIT,
+    REDO_EDIT,
+    SAVE_MAP,
+    PAINT_PRESS,
+    PAINT_RELEASE
+};
+
+struct CommandEvent {
+    Command command;
+    int x; // pointer position (window coordinates) for pointer / mouse commands
+    int y;
+};
+
+// Everything that happened since the previous frame, in order. Consecutive
+// pointer motions are merged into one and only the last size change
+// (user resize, SDL_SetWindowSize, HiDPI switch...) is kept.
+struct InputFrame {
+    CommandEvent* commands = nullptr; // in the frame arena
+    size_t count = 0;
+    bool resized = false;
+    int windowWidth = 0;
+    int windowHeight = 0;
+};
+
+// Turns SDL events into a per frame batch of commands
+class Input {
+
+    private:
+        struct Binding {
+            Uint32 eventType;  // SDL_KEYDOWN, SDL_MOUSEBUTTONDOWN, SDL_MOUSEBUTTONUP, SDL_MOUSEMOTION, SDL_QUIT
+            SDL_Keycode code;  // key or mouse button, 0 when the event has none
+            Uint16 mods;       // KMOD_CTRL / KMOD_SHIFT / KMOD_ALT that must be held, exactly
+            Command command;
+        };
+        std::vector<Binding> bindings;
+
+        Command lookup(Uint32 eventType, SDL_Keycode code, Uint16 mods) const;
+        // merge: replaces the previous command if it is the same one (motions)
+        void push(InputFrame& frame, Command command, int x, int y, bool merge = false) const;
+
+    public:
+        Input(); // default bindings
+
+        void bind(Uint32 eventType, SDL_Keycode code, Uint16 mods, Command command);
+        void clearBindings() { bindings.clear(); }
+
+        // Drain SDL's queue into a batch allocated in frameArena. With
+        // waitMs > 0 the thread sleeps until the first event or the timeout,
+        // so an idle game doesn't spin.
+        InputFrame poll(Arena& frameArena, int waitMs);
+};
@@ -0,0 +1,45 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <cstdint>
+
+#include "memory_stats.h"
+
+// Allocation counters for the main loop. Global operator new/delete are
+// replaced (instrumentation.cpp) to count every C++ heap allocation, arenas
+// and pools are registered to be reported alongside.
+namespace Instrumentation {
+
+    struct FrameStats {
+        uint64_t frames = 0;
+        uint64_t framesWithAllocations = 0;
+        uint64_t allocationsLastFrame = 0;
+        uint64_t maxAllocationsPerFrame = 0;
+        uint64_t totalFrameAllocations = 0;
+    };
+
+    // Global heap, since program start
+    uint64_t getHeapAllocations();
+    uint64_t getHeapBytes();
+    uint64_t getHeapFrees();
+
+    // Call around each main loop iteration
+    void beginFrame();
+    void endFrame();
+    const FrameStats& getFrameStats();
+
+    // Register anything with a getStats() (Arena, ObjectPool) to be reported.
+    // The object must outlive the instrumentation report.
+    typedef MemoryStats (*StatsReader)(const void*);
+    void trackMemory(const char* name, const void* object, StatsReader reader);
+
+    template <typename T>
+    void track(const char* name, const T& object) {
+        trackMemory(name, &object, [](const void* o) { return static_cast<const T*>(o)->getStats(); });
+    }
+
+    // Print everything to stdout
+    void printReport();
+}
+
+#endif // INSTRUMENTATION_H
@@ -2,8 +2,23 @@
 #pragma once
 #include <vector>
 #include <memory>
+#include <algorithm>
+#include <climits>
+#include <cmath>
 #include "grid_cell.h"
 
+// Cell of the legacy map format (no "version"): placed by its top point on
+// screen, for the viewport the map was made with, instead of by its index
+struct ScreenCell {
+    float x;
+    float y;
+    CellType cellType;
+    bool occupied;
+};
+
+// Map cells indexed by their position on the isometric lattice:
+// grid[row][col], +1 col goes down-right on screen, +1 row down-left.
+// Nothing here is in screen units, see Layout for the projection.
 class IsometricGrid {
 private:
     // 2D Vector + it's size 
@@ -17,12 +32,6 @@ private:
 
     // Ratio width:height (2:1) to render a cell
     const float isoRatio = 2.0f;
-    float cellWidth;
-    float cellHeight;
-
-    // viewport dimension when grid was created
-    float viewportWidth;
-    float viewportHeight;
 
     // Convert screen coordinates to grid coordinates
     bool isValidPosition(int x, int y) const {
@@ -48,20 +57,68 @@ public:
     int getHeight() const { return gridHeight; }    
     int getRenderedGridWidth() const { return renderedGridWidth; }
     int getRenderedGridHeight() const { return renderedGridHeight; }    
-    float getViewportWidth() const { return viewportWidth; }
-    float getViewportHeight() const { return viewportHeight; }
-    float getCellWidth() const { return cellWidth; }
-    float getCellHeight() const { return cellHeight; }
     float getIsoRatio() const { return isoRatio; }
 
     // Setters
-    void setViewportWidth(float w) {viewportWidth = w;}
-    void setViewportHeight(float h) {viewportHeight = h;}
-    void setCellWidth(float w) {cellWidth = w;}
-    void setCellHeight(float h) {cellHeight = h;}
     void setGridCell(size_t row, size_t col, const GridCell& newCell) {
         grid[row][col] = newCell;  // Modify a specific cell in the grid
     }
+    void clear() {
+        for (std::vector<GridCell>& row : grid) {
+            std::fill(row.begin(), row.end(), GridCell());
+        }
+    }
+    // Exchange cells with another grid (same size), to commit a decoded map
+    void swapCells(IsometricGrid& other) {
+        grid.swap(other.grid);
+    }
+
+    // Place cells given by their top point on screen (legacy maps): every
+    // top point sits on the (cellWidth / 2, cellHeight / 2) lattice,
+    // x = (col - row) * cellWidth / 2, y = (col + row) * cellHeight / 2.
+    // The drawn area is moved to the grid's top left corner. Returns how
+    // many cells were dropped (off the lattice, overlapping or too big).
+    int setFromScreenCells(const std::vector<ScreenCell>& cells, float cellWidth, float cellHeight) {
+        const float halfW = cellWidth / 2;
+        const float halfH = cellHeight / 2;
+
+        struct Placed { int row; int col; const ScreenCell* cell; };
+        std::vector<Placed> placed;
+        int dropped = 0;
+        bool haveOrigin = false;
+        float originX = 0, originY = 0;
+        int minRow = INT_MAX, minCol = INT_MAX;
+        for (const ScreenCell& cell : cells) {
+            if (cell.cellType == NO_RENDER) {
+                continue;
+            }
+            if (!haveOrigin) {
+                originX = cell.x;
+                originY = cell.y;
+                haveOrigin = true;
+            }
+            const int a = static_cast<int>(std::lround((cell.x - originX) / halfW));
+            const int b = static_cast<int>(std::lround((cell.y - originY) / halfH));
+            if ((a + b) % 2 != 0) {
+                ++dropped; // not on the lattice, broken map data
+                continue;
+            }
+            placed.push_back({ (b - a) / 2, (b + a) / 2, &cell });
+            minRow = std::min(minRow, (b - a) / 2);
+            minCol = std::min(minCol, (b + a) / 2);
+        }
+
+        clear();
+        for (const Placed& p : placed) {
+            GridCell* target = getCell(p.row - minRow, p.col - minCol);
+            if (target == nullptr || target->cellType != NO_RENDER) {
+                ++dropped; // doesn't fit, or two cells drawn at the same spot (first kept)
+                continue;
+            }
+            *target = GridCell(p.cell->cellType, p.cell->occupied);
+        }
+        return dropped;
+    }
     
     
 
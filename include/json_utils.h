@@ -1,6 +1,8 @@
 #pragma once
 #include <vector>
 #include <fstream>
+#include <iostream>
+#include <string>
 #include <nlohmann/json.hpp>
 
 #include "isometric_grid.h"
@@ -31,39 +33,68 @@ namespace JsonUtils {
         return WALKABLE;
     }
 
+    // One character per cell in format 2 maps, a row reads like the map
+    inline char cellTypeToChar(CellType type) {
+        switch (type) {
+            case WALKABLE: return 'W';
+            case EMPTY: return 'E';
+            case OBSTACLE: return 'O';
+            default: return '.';
+        }
+    }
+
+    inline CellType charToCellType(char c) {
+        switch (c) {
+            case 'W': return WALKABLE;
+            case 'E': return EMPTY;
+            case 'O': return OBSTACLE;
+            default: return NO_RENDER;
+        }
+    }
+
+    // Map file format written by saveGridToJson. Format 2 only has grid
+    // positions: "cells" is one string per row and "occupied" the list of
+    // [row, col] with a character on them. Files without a version are the
+    // legacy format (every cell with its screen position) and are
+    // converted when loaded.
+    const int mapFormatVersion = 2;
+
+    // Grid as a format 2 JSON document
+    inline json gridToJson(const IsometricGrid& isometricGrid)
+    {
+        const std::vector<std::vector<GridCell>>& grid = isometricGrid.getGrid();
+
+        json j;
+        j["version"] = mapFormatVersion;
+        j["rows"] = isometricGrid.getHeight();
+        j["cols"] = isometricGrid.getWidth();
+
+        // Store cells
+        json cells = json::array();
+        json occupied = json::array();
+        for (size_t row = 0; row < grid.size(); ++row) {
+            std::string line;
+            for (size_t col = 0; col < grid[row].size(); ++col) {
+                line += cellTypeToChar(grid[row][col].cellType);
+                if (grid[row][col].occupied) {
+                    occupied.push_back({row, col});
+                }
+            }
+            cells.push_back(line);
+        }
+        j["cells"] = cells;
+        j["occupied"] = occupied;
+        return j;
+    }
+
     // Save grid to JSON file
     inline bool saveGridToJson(const IsometricGrid& isometricGrid, const std::string filename)
     {
         const std::string fullPath = mapsFolder + filename;
         std::cout <<  fullPath << std::endl;
 
-        const std::vector<std::vector<GridCell>>& grid = isometricGrid.getGrid();
-
         try {
-            json j;
-            j["rows"] = isometricGrid.getWidth();
-            j["cols"] = isometricGrid.getHeight();
-            j["cellWidth"] = isometricGrid.getCellWidth();
-            j["cellHeight"] = isometricGrid.getCellHeight();
-            j["viewportwidth"] = isometricGrid.getViewportWidth();
-            j["viewportHeight"] = isometricGrid.getViewportHeight();
-            
-            // Store cells
-            json cells = json::array();
-            for (const auto& row : grid) {
-                json jsonRow = json::array();
-                for (const auto& cell : row) {
-                    //std::cout << cell.x << std::endl;
-                    json cellJson;
-                    cellJson["x"] = cell.x;
-                    cellJson["y"] = cell.y;
-                    cellJson["type"] = cellTypeToString(cell.cellType);
-                    cellJson["occupied"] = cell.occupied;
-                    jsonRow.push_back(cellJson);
-                }
-                cells.push_back(jsonRow);
-            }
-            j["cells"] = cells;
+            const json j = gridToJson(isometricGrid);
 
             // Write to file
             std::ofstream file(fullPath);
@@ -78,7 +109,84 @@ namespace JsonUtils {
         }
     }
 
-    // Load grid from JSON file
+    // Legacy maps: cells[i][j] with their screen position, snapped back
+    // to the lattice
+    inline bool legacyGridFromJson(IsometricGrid& isometricGrid, const json& j, int* droppedCells)
+    {
+        const int rows = j["rows"];
+        const int cols = j["cols"];
+
+        std::vector<ScreenCell> screenCells;
+        screenCells.reserve(rows * cols);
+        const auto& cells = j["cells"];
+        for (int i = 0; i < rows; ++i) {
+            for (int k = 0; k < cols; ++k) {
+                const auto& cellJson = cells[i][k];
+                screenCells.push_back({ cellJson["x"], cellJson["y"],
+                                        stringToCellType(cellJson["type"]), cellJson["occupied"] });
+            }
+        }
+
+        const int dropped = isometricGrid.setFromScreenCells(screenCells, j["cellWidth"], j["cellHeight"]);
+        if (droppedCells) {
+            *droppedCells = dropped;
+        }
+        else if (dropped > 0) {
+            std::cout << "legacy map: " << dropped << " cells didn't fit the grid" << std::endl;
+        }
+        return true;
+    }
+
+    // Fill the grid from a parsed map (format 2 or legacy). Throws on
+    // malformed documents. droppedCells gets how many cells didn't fit.
+    // The map is decoded aside, the grid is only changed on success.
+    inline bool gridFromJson(IsometricGrid& isometricGrid, const json& j, int* droppedCells = nullptr)
+    {
+        IsometricGrid decoded;
+        if (!j.contains("version")) {
+            if (!legacyGridFromJson(decoded, j, droppedCells)) {
+                return false;
+            }
+            isometricGrid.swapCells(decoded);
+            return true;
+        }
+        if (j["version"].get<int>() > mapFormatVersion) {
+            return false; // newer than this build
+        }
+
+        // Bigger maps than the grid are cut
+        const int rows = j["rows"];
+        const int cols = j["cols"];
+        int dropped = 0;
+
+        const auto& cells = j["cells"];
+        for (int row = 0; row < rows && row < static_cast<int>(cells.size()); ++row) {
+            const std::string line = cells[row];
+            for (int col = 0; col < cols && col < static_cast<int>(line.size()); ++col) {
+                const CellType type = charToCellType(line[col]);
+                if (GridCell* cell = decoded.getCell(row, col)) {
+                    *cell = GridCell(type, false);
+                }
+                else if (type != NO_RENDER) {
+                    ++dropped;
+                }
+            }
+        }
+        if (j.contains("occupied")) {
+            for (const auto& pos : j["occupied"]) {
+                if (GridCell* cell = decoded.getCell(pos[0], pos[1])) {
+                    cell->occupied = true;
+                }
+            }
+        }
+        if (droppedCells) {
+            *droppedCells = dropped;
+        }
+        isometricGrid.swapCells(decoded);
+        return true;
+    }
+
+    // Load grid from JSON file (format 2 or legacy)
     inline bool loadGridFromJson(IsometricGrid& isometricGrid, const std::string filename)
     {
         const std::string filePath = mapsFolder + filename;
@@ -90,60 +198,7 @@ namespace JsonUtils {
 
             json j;
             file >> j;
-
-            int rows = j["rows"];
-            int cols = j["cols"];
-            
-            isometricGrid.setCellWidth(j["cellWidth"]);
-            isometricGrid.setCellHeight(j["cellHeight"]);
-            isometricGrid.setViewportWidth(j["viewportwidth"]);
-            isometricGrid.setViewportHeight(j["viewportHeight"]);
-            
-            std::cout << "---- load" << std::endl;
-            std::cout << "cellWidth : " << j["cellWidth"] << std::endl;
-            std::cout << "cellHeight : " << j["cellHeight"] << std::endl;
-            std::cout << "viewportwidth : " << j["viewportwidth"] << std::endl;
-            std::cout << "viewportHeight : " << j["viewportHeight"] << std::endl;
-            std::cout << "ehg : " << j["cells"][0][14]["type"] << std::endl;
-            std::cout << "ehg : " << j["cells"][0][14]["x"] << std::endl;
-            std::cout << "ehg : " << j["cells"][0][14]["y"] << std::endl;
-
-            std::vector<std::vector<GridCell>>& grid = isometricGrid.getGrid();
-            // grid.clear();
-            // grid.resize(rows, std::vector<GridCell>(cols));
-
-            std::cout << "rows : " << rows << std::endl;
-            std::cout << "cols : " << cols << std::endl;
-
-            const auto& cells = j["cells"];
-            for (int i = 0; i < rows; ++i) {
-                for (int j = 0; j < cols; ++j) {
-                    const auto& cellJson = cells[i][j];
-
-                    GridCell cell(
-                        cellJson["x"],
-                        cellJson["y"],
-                        stringToCellType(cellJson["type"]),
-                        cellJson["occupied"]
-                    );
- 
-                    isometricGrid.setGridCell(i,j, cell);
-                    if (i == 0 && j == 14){
-                        std::cout << "---- check" << std::endl;
-                        std::cout << "cellJson x" << cellJson["x"] << std::endl;
-                        std::cout << "cellJson y : " << cellJson["y"] << std::endl;
-                        std::cout << "cellJson type : " << stringToCellType(cellJson["type"]) << std::endl;
-                        std::cout << "cellJson occupied : " << cellJson["occupied"] << std::endl;
-                        
-                        std::cout << "pls : " << isometricGrid.getGrid()[0][14].x << std::endl;
-
-                        // it prints well here
-                    }
-
-
-                }
-            }
-            return true;
+            return gridFromJson(isometricGrid, j);
         }
         catch (const std::exception& e) {
             return false;
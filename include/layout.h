@@ -0,0 +1,66 @@
+#pragma once
+#include <SDL2/SDL.h>
+
+#include <cstdint>
+
+#include "isometric_grid.h"
+
+// Share of the window each viewport gets, in percent
+const int SIDE_VIEWPORT_PERCENT = 15; // left and right columns
+const int MAIN_VIEWPORT_HEIGHT_PERCENT = 80; // main viewport, bottom gets the rest
+
+// Screen layout: viewport rects and the projection of the grid lattice
+// into the main viewport. Everything is computed once per resize / map
+// change, in renderer pixels (differs from window points on HiDPI screens).
+class Layout {
+
+    private:
+        int outputWidth = 0; // pixels, what the renderer draws
+        int outputHeight = 0;
+        // Mouse events are in window points
+        float pixelsPerPointX = 1.0f;
+        float pixelsPerPointY = 1.0f;
+
+        // idx 0 = main / 1 = bottom / 2 = left / 3 = right
+        SDL_Rect viewports[4] = {};
+
+        // Lattice extent of the drawn cells, along a = col - row
+        // (horizontal) and b = col + row (vertical)
+        bool hasCells = false;
+        int minA = 0, maxA = 0, minB = 0, maxB = 0;
+        int isoRatio = 2;
+
+        // Projection: top point of cell (row, col) relative to the main
+        // viewport is origin + ((col - row) * halfW, (col + row) * halfH)
+        int halfWidth = 0;
+        int halfHeight = 0;
+        int originX = 0;
+        int originY = 0;
+
+        uint32_t revision = 0; // bumped by every recompute
+
+        void computeViewports();
+        void computeProjection();
+
+    public:
+        // Window size in points and renderer output size in pixels
+        void resize(int windowW, int windowH, int outputW, int outputH);
+        // Fit the drawn cells of a map (not NO_RENDER) in the main viewport
+        void setGrid(const IsometricGrid& grid);
+
+        // Getters
+        const SDL_Rect& getViewport(int idx) const { return viewports[idx]; }
+        int getCellWidth() const { return halfWidth * 2; }
+        int getCellHeight() const { return halfHeight * 2; }
+        uint32_t getRevision() const { return revision; }
+
+        // Top point of a cell, relative to the main viewport
+        void cellTop(int row, int col, int& x, int& y) const {
+            x = originX + (col - row) * halfWidth;
+            y = originY + (col + row) * halfHeight;
+        }
+
+        // Lattice cell under a window position (points), false outside of
+        // the main viewport. The cell may be outside the grid.
+        bool pick(int windowX, int windowY, int& row, int& col) const;
+};
@@ -0,0 +1,142 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "isometric_grid.h"
+
+// Wait that long after the last edit before saving, so a drag is saved once
+const uint32_t AUTOSAVE_DELAY_MS = 1000;
+
+// In-app map editing: paints cell types on the grid, keeps every change in
+// an undo/redo journal of cell deltas (4 bytes each) and autosaves in the
+// background once the map is dirty. Autosave only appends the cells changed
+// since the last save to the map's edit log (map_files.h), the map itself
+// is only rewritten by an explicit save. Knows nothing about SDL, picking
+// the cell under the mouse is up to the caller.
+class MapEditor {
+
+    private:
+        // One painted cell
+        struct CellDelta {
+            uint16_t cell; // grid flat index (row * width + col)
+            uint8_t before;
+            uint8_t after;
+        };
+
+        IsometricGrid& grid;
+        std::string filename;
+        bool active = false;
+        CellType brush = OBSTACLE;
+
+        // Journal: a stroke (mouse down -> up) is one undo step.
+        // strokeStarts[i] is where stroke i begins in deltas, strokes
+        // [0, appliedStrokes) are applied, the rest can be redone.
+        std::vector<CellDelta> deltas;
+        std::vector<uint32_t> strokeStarts;
+        size_t appliedStrokes = 0;
+        bool inStroke = false;
+        bool strokeRecorded = false; // current stroke changed something
+
+        // Cells changed since the last takeChangedCells()
+        std::vector<int> changedCells;
+
+        // Cells changed since the last save handed to the saver: what the
+        // next autosave appends to the edit log
+        std::vector<uint8_t> unsaved; // per cell, 1 if in unsavedCells
+        std::vector<uint16_t> unsavedCells;
+
+        // Bumped on every change. The map is dirty while it differs from the
+        // revision of the last save that made it to disk.
+        uint64_t revision = 0;
+        uint64_t savedRevision = 0;
+        uint32_t lastEditTime = 0;
+        bool fullSaveRequested = false;
+        // The last save failed: the next try waits AUTOSAVE_DELAY_MS after it
+        bool saveFailed = false;
+        uint32_t failedSaveTime = 0;
+
+        // One save at a time: the render thread picks the unsaved cells, the
+        // saver encodes and writes them. A failed save hands its cells
+        // back, they go with the next autosave.
+        struct SaveJob {
+            std::string name;
+            bool full = false;                   // rewrite the map, drop its edit log
+            std::unique_ptr<IsometricGrid> grid; // full save only
+            int rows = 0;
+            int cols = 0;
+            std::vector<uint16_t> cells;
+            std::vector<uint8_t> types;
+        };
+        bool saveInFlight = false;
+        uint64_t inFlightRevision = 0;
+        bool inFlightFull = false;
+        std::vector<uint16_t> inFlightCells;
+
+        std::thread saver;
+        std::mutex mutex;
+        std::condition_variable wakeSaver;
+        std::condition_variable saveDone;
+        SaveJob job;          // waiting for the saver while jobQueued
+        bool jobQueued = false;
+        bool jobDone = false; // result of the job in flight, not collected yet
+        bool jobSucceeded = false;
+        bool stopping = false;
+
+        void setCell(int cell, CellType type);
+        void markUnsaved(int cell);
+        void requestSave(bool full);
+        // Result of the save in flight, if it is done. wait blocks until it is.
+        void collectSave(uint32_t nowMs, bool wait);
+        void saverLoop();
+        bool writeJob(const SaveJob& job);
+
+    public:
+        explicit MapEditor(IsometricGrid& grid);
+        ~MapEditor(); // autosaves what is still dirty
+
+        MapEditor(const MapEditor&) = delete;
+        MapEditor& operator=(const MapEditor&) = delete;
+
+        // Getters
+        bool isActive() const { return active; }
+        CellType getBrush() const { return brush; }
+        uint64_t getRevision() const { return revision; }
+        bool isDirty() const { return revision != savedRevision; }
+        bool canUndo() const { return appliedStrokes > 0; }
+        bool canRedo() const { return appliedStrokes < strokeStarts.size(); }
+
+        // Setters
+        void setFilename(const std::string& name) { filename = name; }
+        void setActive(bool b);
+        void setBrush(CellType type) { brush = type; }
+
+        // Painting, grid (row, col) of the cell under the mouse
+        void beginStroke();
+        void paint(int row, int col, uint32_t nowMs);
+        void endStroke();
+
+        // Whole strokes, false when there was nothing to undo / redo
+        bool undo(uint32_t nowMs);
+        bool redo(uint32_t nowMs);
+
+        // Once per frame: collects the last save and hands the unsaved cells
+        // to the saver when they have waited AUTOSAVE_DELAY_MS and no stroke
+        // is in progress
+        void update(uint32_t nowMs);
+
+        // Rewrite the whole map file (next update()), its edit log goes away
+        void requestFullSave() { fullSaveRequested = true; }
+
+        // Grid flat indices changed since the last call (may repeat)
+        void takeChangedCells(std::vector<int>& out);
+
+        // Forget the journal, after the grid was replaced (map load)
+        void resetJournal();
+        // Replay the map's edit log over the grid that was just loaded
+        void loadEdits();
+};
@@ -0,0 +1,250 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "json_utils.h"
+#include "sim/varint.h"
+
+// Map loading / saving by file extension. JSON maps (json_utils.h) are the
+// editable source, ".map" files the runtime format map_tool converts them
+// to: "SMAP", version, rows / cols, the cell types packed 4 per byte
+// (2 bits, row major) then the occupied cells. ~300 bytes for a 33x33 map
+// and nothing to parse.
+// The editor's autosave doesn't touch the map, it appends what changed to
+// an edit log next to it ("<map>.edits"): "SEDT", version, rows / cols,
+// then (cell index, cell type) records, the last one of a cell wins.
+namespace MapFiles {
+
+    const std::string binaryExtension = ".map";
+    const uint8_t MAP_MAGIC[4] = { 'S', 'M', 'A', 'P' };
+    const uint32_t MAP_BINARY_VERSION = 1;
+    const uint64_t MAX_MAP_SIDE = INT16_MAX; // rows / cols
+
+    const std::string editsExtension = ".edits";
+    const uint8_t EDITS_MAGIC[4] = { 'S', 'E', 'D', 'T' };
+    const uint32_t EDITS_VERSION = 1;
+
+    inline bool isBinary(const std::string& filename) {
+        return filename.size() >= binaryExtension.size() &&
+               filename.compare(filename.size() - binaryExtension.size(), binaryExtension.size(), binaryExtension) == 0;
+    }
+
+    inline void encodeBinary(const IsometricGrid& isometricGrid, std::vector<uint8_t>& bytes) {
+        const std::vector<std::vector<GridCell>>& grid = isometricGrid.getGrid();
+        const int rows = isometricGrid.getHeight();
+        const int cols = isometricGrid.getWidth();
+
+        bytes.assign(MAP_MAGIC, MAP_MAGIC + 4);
+        Sim::ByteWriter writer(bytes);
+        writer.writeVarint(MAP_BINARY_VERSION);
+        writer.writeVarint(rows);
+        writer.writeVarint(cols);
+
+        std::vector<int> occupied;
+        uint8_t packed = 0;
+        for (int idx = 0; idx < rows * cols; ++idx) {
+            const GridCell& cell = grid[idx / cols][idx % cols];
+            packed |= static_cast<uint8_t>(cell.cellType & 3) << ((idx & 3) * 2);
+            if ((idx & 3) == 3) {
+                writer.writeByte(packed);
+                packed = 0;
+            }
+            if (cell.occupied) {
+                occupied.push_back(idx);
+            }
+        }
+        if ((rows * cols) & 3) {
+            writer.writeByte(packed);
+        }
+
+        writer.writeVarint(occupied.size());
+        for (int idx : occupied) {
+            writer.writeVarint(idx);
+        }
+    }
+
+    // False on a bad header or a truncated file, the grid is then left
+    // untouched. droppedCells gets how many drawn cells didn't fit the grid.
+    inline bool decodeBinary(IsometricGrid& isometricGrid, const std::vector<uint8_t>& bytes, int* droppedCells = nullptr) {
+        if (bytes.size() < 4 || !std::equal(MAP_MAGIC, MAP_MAGIC + 4, bytes.begin())) {
+            return false;
+        }
+        Sim::ByteReader reader(bytes.data() + 4, bytes.size() - 4);
+        if (reader.readVarint() != MAP_BINARY_VERSION) {
+            return false;
+        }
+        // Bounded so rows * cols stays far from overflowing, a bogus header
+        // can't ask for billions of cells
+        const uint64_t rows = reader.readVarint();
+        const uint64_t cols = reader.readVarint();
+        if (!reader.ok() || rows == 0 || cols == 0 || rows > MAX_MAP_SIDE || cols > MAX_MAP_SIDE) {
+            return false;
+        }
+        const uint64_t cellCount = rows * cols;
+
+        int dropped = 0;
+        IsometricGrid decoded;
+        uint8_t packed = 0;
+        for (uint64_t idx = 0; idx < cellCount; ++idx) {
+            if ((idx & 3) == 0) {
+                packed = reader.readByte();
+                if (!reader.ok()) {
+                    return false; // truncated, no need to walk the rest
+                }
+            }
+            const CellType type = static_cast<CellType>((packed >> ((idx & 3) * 2)) & 3);
+            if (GridCell* cell = decoded.getCell(static_cast<int>(idx / cols), static_cast<int>(idx % cols))) {
+                *cell = GridCell(type, false);
+            }
+            else if (type != NO_RENDER) {
+                ++dropped;
+            }
+        }
+
+        const uint64_t occupiedCount = reader.readVarint();
+        for (uint64_t i = 0; i < occupiedCount && reader.ok(); ++i) {
+            const uint64_t idx = reader.readVarint();
+            if (!reader.ok() || idx >= cellCount) {
+                return false;
+            }
+            if (GridCell* cell = decoded.getCell(static_cast<int>(idx / cols), static_cast<int>(idx % cols))) {
+                cell->occupied = true;
+            }
+        }
+        if (!reader.ok()) {
+            return false;
+        }
+        if (droppedCells) {
+            *droppedCells = dropped;
+        }
+        isometricGrid.swapCells(decoded);
+        return true;
+    }
+
+    inline bool readFile(const std::string& path, std::vector<uint8_t>& bytes) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    inline bool writeFile(const std::string& path, const std::vector<uint8_t>& bytes, bool append = false) {
+        std::ofstream file(path, append ? std::ios::binary | std::ios::app : std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        file.flush();
+        return file.good();
+    }
+
+    // -- Edit log
+    inline void encodeEditsHeader(int rows, int cols, std::vector<uint8_t>& bytes) {
+        bytes.insert(bytes.end(), EDITS_MAGIC, EDITS_MAGIC + 4);
+        Sim::ByteWriter writer(bytes);
+        writer.writeVarint(EDITS_VERSION);
+        writer.writeVarint(rows);
+        writer.writeVarint(cols);
+    }
+
+    inline void encodeEdit(int cell, CellType type, std::vector<uint8_t>& bytes) {
+        Sim::ByteWriter writer(bytes);
+        writer.writeVarint(cell);
+        writer.writeByte(static_cast<uint8_t>(type));
+    }
+
+    // Replays a log over the grid it was written for. False (grid
+    // untouched) on a bad header or a log made for other dimensions. A
+    // record cut short by a crash ends the log, records that don't fit the
+    // map are skipped. validBytes gets where the last whole record ends.
+    inline bool applyEdits(IsometricGrid& isometricGrid, const std::vector<uint8_t>& bytes, size_t* validBytes = nullptr) {
+        if (bytes.size() < 4 || !std::equal(EDITS_MAGIC, EDITS_MAGIC + 4, bytes.begin())) {
+            return false;
+        }
+        Sim::ByteReader reader(bytes.data() + 4, bytes.size() - 4);
+        const uint64_t version = reader.readVarint();
+        const uint64_t rows = reader.readVarint();
+        const uint64_t cols = reader.readVarint();
+        if (!reader.ok() || version != EDITS_VERSION ||
+            rows != static_cast<uint64_t>(isometricGrid.getHeight()) ||
+            cols != static_cast<uint64_t>(isometricGrid.getWidth())) {
+            return false;
+        }
+
+        size_t valid = 4 + reader.getOffset();
+        while (!reader.atEnd()) {
+            const uint64_t idx = reader.readVarint();
+            const uint8_t type = reader.readByte();
+            if (!reader.ok()) {
+                break;
+            }
+            valid = 4 + reader.getOffset();
+            if (idx >= rows * cols || type >= NO_RENDER) {
+                continue;
+            }
+            // Only cells the map draws can be painted
+            GridCell* cell = isometricGrid.getCell(static_cast<int>(idx / cols), static_cast<int>(idx % cols));
+            if (cell != nullptr && cell->cellType != NO_RENDER) {
+                cell->cellType = static_cast<CellType>(type);
+            }
+        }
+        if (validBytes) {
+            *validBytes = valid;
+        }
+        return true;
+    }
+
+    // Any path, format picked from the extension
+    inline bool loadGridFromPath(IsometricGrid& isometricGrid, const std::string& path) {
+        try {
+            if (isBinary(path)) {
+                std::vector<uint8_t> bytes;
+                return readFile(path, bytes) && decodeBinary(isometricGrid, bytes);
+            }
+            std::ifstream file(path);
+            if (!file.is_open()) {
+                return false;
+            }
+            json j;
+            file >> j;
+            return JsonUtils::gridFromJson(isometricGrid, j);
+        }
+        catch (const std::exception& e) {
+            return false;
+        }
+    }
+
+    inline bool saveGridToPath(const IsometricGrid& isometricGrid, const std::string& path, bool binary) {
+        try {
+            if (binary) {
+                std::vector<uint8_t> bytes;
+                encodeBinary(isometricGrid, bytes);
+                return writeFile(path, bytes);
+            }
+            std::ofstream file(path);
+            if (!file.is_open()) {
+                return false;
+            }
+            file << JsonUtils::gridToJson(isometricGrid).dump(4);
+            return file.good();
+        }
+        catch (const std::exception& e) {
+            return false;
+        }
+    }
+
+    // Maps folder
+    inline bool loadGrid(IsometricGrid& isometricGrid, const std::string& filename) {
+        return loadGridFromPath(isometricGrid, JsonUtils::mapsFolder + filename);
+    }
+
+    inline bool saveGrid(const IsometricGrid& isometricGrid, const std::string& filename) {
+        return saveGridToPath(isometricGrid, JsonUtils::mapsFolder + filename, isBinary(filename));
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// What arenas and pools report to the instrumentation layer.
+// Units are bytes for arenas, objects for pools.
+struct MemoryStats {
+    size_t used;
+    size_t capacity;
+    size_t peak;
+    uint64_t allocations; // since creation
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "memory_stats.h"
+
+// Fixed capacity pool of T with stable addresses. Slots are allocated once
+// up front and recycled through a free list, so create/destroy never touch
+// the global heap. create() returns nullptr when the pool is full.
+template <typename T>
+class ObjectPool {
+private:
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+        uint32_t nextFree;
+        bool live;
+    };
+
+    static const uint32_t NONE = 0xFFFFFFFF;
+
+    std::unique_ptr<Slot[]> slots;
+    uint32_t capacity;
+    uint32_t freeHead;
+    size_t liveCount = 0;
+    size_t peakCount = 0;
+    uint64_t allocations = 0;
+
+    static T* valueOf(Slot& slot) { return reinterpret_cast<T*>(slot.storage); }
+
+public:
+    explicit ObjectPool(uint32_t capacity)
+        : slots(new Slot[capacity]), capacity(capacity), freeHead(capacity > 0 ? 0 : NONE) {
+        for (uint32_t i = 0; i < capacity; ++i) {
+            slots[i].nextFree = (i + 1 < capacity) ? i + 1 : NONE;
+            slots[i].live = false;
+        }
+    }
+
+    ~ObjectPool() { clear(); }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        if (freeHead == NONE) {
+            return nullptr;
+        }
+        Slot& slot = slots[freeHead];
+        freeHead = slot.nextFree;
+        slot.live = true;
+        ++liveCount;
+        ++allocations;
+        peakCount = liveCount > peakCount ? liveCount : peakCount;
+        return new (slot.storage) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T* object) {
+        Slot* slot = reinterpret_cast<Slot*>(reinterpret_cast<unsigned char*>(object) - offsetof(Slot, storage));
+        object->~T();
+        slot->live = false;
+        slot->nextFree = static_cast<uint32_t>(slot - slots.get());
+        std::swap(slot->nextFree, freeHead);
+        --liveCount;
+    }
+
+    // Destroy every live object
+    void clear() {
+        for (uint32_t i = 0; i < capacity; ++i) {
+            if (slots[i].live) {
+                destroy(valueOf(slots[i]));
+            }
+        }
+    }
+
+    // Calls f(T&) for every live object (slot order)
+    template <typename F>
+    void forEach(F f) {
+        for (uint32_t i = 0; i < capacity; ++i) {
+            if (slots[i].live) {
+                f(*valueOf(slots[i]));
+            }
+        }
+    }
+
+    size_t getLiveCount() const { return liveCount; }
+    uint32_t getCapacity() const { return capacity; }
+    bool isFull() const { return freeHead == NONE; }
+
+    MemoryStats getStats() const {
+        return { liveCount, capacity, peakCount, allocations };
+    }
+};
@@ -0,0 +1,105 @@
+#pragma once
+#include <SDL2/SDL.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "layout.h"
+#include "memory_stats.h"
+#include "object_pool.h"
+#include "sim/rng.h"
+
+// Effect looks (colors, lifetimes, motion), see EFFECT_STYLES in particles.cpp
+enum EffectKind {
+    EFFECT_HIT,   // sparks where an attack lands
+    EFFECT_DUST,  // puff where a unit stops
+    EFFECT_SMOKE, // rising smoke, where a unit died
+    EFFECT_AURA,  // glow over a cell (active unit marker)
+    EFFECT_KIND_COUNT
+};
+
+// Particles for spell effects.
+//
+// Positions are in lattice units, x along col - row in half cell widths
+// and y along col + row in half cell heights (same axes as Layout), so a
+// resize doesn't touch them. Storage is a structure of arrays of fixed
+// capacity: the update is one SIMD pass per array, dead particles are
+// swap-removed so the live ones stay packed at the front, and drawing is
+// a single SDL_RenderGeometry call. Nothing is allocated after construction.
+class ParticleSystem {
+
+    public:
+        // Keeps spawning particles over a cell. Emitters with a duration
+        // are destroyed when it runs out, the others live until stopEmitter().
+        struct Emitter {
+            EffectKind kind;
+            float x;
+            float y;
+            float remaining; // seconds, < 0 = until stopped
+            float accumulator; // particles owed, fractional part of rate * dt
+        };
+
+        static const uint32_t MAX_PARTICLES = 16384;
+        static const uint32_t MAX_EMITTERS = 512;
+
+        ParticleSystem();
+
+        ParticleSystem(const ParticleSystem&) = delete;
+        ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+        // Spawn count particles at once over cell (row, col), count <= 0
+        // uses the style's burst size. Silently capped at MAX_PARTICLES.
+        void burst(EffectKind kind, int row, int col, int count = 0);
+        // nullptr if every emitter is in use. seconds <= 0 runs until stopped.
+        Emitter* startEmitter(EffectKind kind, int row, int col, float seconds = 0.0f);
+        void moveEmitter(Emitter* emitter, int row, int col);
+        void stopEmitter(Emitter* emitter);
+        // Particles and emitters
+        void clear();
+
+        // Advance everything by dt seconds
+        void update(float dt);
+
+        // Fill the vertex buffer for the current layout, returns the number
+        // of particles to draw (4 vertices / 6 indices each)
+        uint32_t buildVertices(const Layout& layout);
+        const SDL_Vertex* getVertices() const { return vertices.data(); }
+        const int* getIndices() const { return indices.data(); }
+
+        uint32_t getCount() const { return count; }
+        bool isIdle() const { return count == 0 && emitters.getLiveCount() == 0; }
+        // Particles, allocations = spawned since creation
+        MemoryStats getStats() const { return { count, MAX_PARTICLES, peakCount, spawned }; }
+        MemoryStats getEmitterStats() const { return emitters.getStats(); }
+
+    private:
+        // Structure of arrays, [0, count) live. Sized to a multiple of the
+        // SIMD width so the update never needs a scalar tail on padding.
+        std::vector<float> posX;
+        std::vector<float> posY;
+        std::vector<float> velX;
+        std::vector<float> velY;
+        std::vector<float> gravity;
+        std::vector<float> life; // seconds left
+        std::vector<float> invMaxLife;
+        std::vector<float> fade; // life / max life, 1 -> 0
+        std::vector<float> size; // half extent, in half cell heights
+        std::vector<SDL_Color> color;
+        uint32_t count = 0;
+        size_t peakCount = 0;
+        uint64_t spawned = 0;
+
+        ObjectPool<Emitter> emitters;
+        Sim::Rng rng;
+
+        // Built by buildVertices(), indices never change
+        std::vector<SDL_Vertex> vertices;
+        std::vector<int> indices;
+
+        float random(); // [0, 1)
+        void spawn(EffectKind kind, float x, float y);
+        // Position / velocity / life, true if any particle died
+        bool integrate(float dt);
+        // Swap-remove the dead ones
+        void compact();
+};
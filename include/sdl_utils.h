@@ -5,8 +5,18 @@
 #include <SDL2/SDL_image.h>
 
 #include <memory>
+#include <string>
+#include <vector>
 
+#include "arena.h"
+#include "input.h"
 #include "isometric_grid.h"
+#include "layout.h"
+#include "map_editor.h"
+#include "particles.h"
+#include "sim/battle.h"
+#include "sim/vision.h"
+#include "soft_rasterizer.h"
 
 class SDLResources {
 
@@ -17,13 +27,64 @@ class SDLResources {
         int windowWidth;
         int windowHeight;
         bool quit;
-        bool windowResized = false;
 
-        // viewports data
-        SDL_Rect viewports[4];
+        // events -> commands, once per frame
+        Input input;
+
+        // viewports and grid projection, recomputed on resize / map change
+        Layout layout;
 
         // grid data
         IsometricGrid isometricGrid;
+        std::string mapFilename;
+
+        // editor mode, paints isometricGrid (toggled with E)
+        MapEditor mapEditor;
+        std::vector<int> editedCells; // scratch, cells to recolor
+        bool painting = false; // paint button held
+
+        // Screen space geometry of the grid for the current layout.
+        // Rebuilt only on resize / map change, see rebuildGridGeometry()
+        struct CellGeometry {
+            int x; // top point, relative to the main viewport
+            int y;
+            bool dark; // alternate color
+            bool hidden; // fog of war, drawn dimmed
+            CellType type;
+            int gridIndex; // IsometricGrid flat index (row * width + col)
+            int boardIndex; // Sim::Board cell (-1 = none / no battle)
+        };
+        bool gridGeometryDirty = true;
+        int cachedCellWidth = 0;
+        int cachedCellHeight = 0;
+        std::vector<CellGeometry> cellGeometry;
+        std::vector<SDL_Vertex> gridVertices; // 4 per cell
+        std::vector<int> gridIndices; // 6 per cell (2 triangles)
+        // Outlines as 1 pixel diamond rings, black, 8 vertices / 24 indices per cell
+        std::vector<SDL_Vertex> outlineVertices;
+        std::vector<int> outlineIndices;
+        std::vector<int> geometryIndex; // grid flat index -> cellGeometry index (-1 = not drawn)
+
+        // battle to draw on top of the grid (owned by the game loop)
+        const Sim::Battle* battle = nullptr;
+
+        // fog of war of viewerTeam, cells get recolored only when the
+        // vision revision changes (no fog while editing)
+        const Sim::Vision* vision = nullptr;
+        int viewerTeam = 0;
+        bool visibilityApplied = false;
+        uint32_t appliedVisionRevision = 0;
+
+        // spell effects, drawn over the grid and units
+        ParticleSystem effects;
+
+        // software rendering (no GPU): grid is rasterized on the CPU
+        // into a streaming texture the size of the main viewport
+        bool softwareRendering = false;
+        SDL_Texture* gridTexture = nullptr;
+        int gridTextureWidth = 0;
+        int gridTextureHeight = 0;
+        SoftRasterizer rasterizer;
 
     public:
         // Constructor / Destructor
@@ -41,14 +102,32 @@ class SDLResources {
         bool getQuit() { return quit; }
         int getWindowWidth() const { return windowWidth; }
         int getWindowHeight() const { return windowHeight; }
+        bool isSoftwareRendering() const { return softwareRendering; }
+        const IsometricGrid& getIsometricGrid() const { return isometricGrid; }
+        const MapEditor& getMapEditor() const { return mapEditor; }
+        bool isEditing() const { return mapEditor.isActive(); }
+        Input& getInput() { return input; } // to change the bindings
+        ParticleSystem& getEffects() { return effects; } // updated by the game loop
 
         // Setters
         void setQuit(bool b) { quit =b; }
         void loadMap(std::string filename); // setGrid() equivalent
+        void setBattle(const Sim::Battle* b) { battle = b; gridGeometryDirty = true; }
+        void setVision(const Sim::Vision* v, int team) { vision = v; viewerTeam = team; visibilityApplied = false; }
 
         // Event Handling
-        void processEvents();
-        void screenToGrid(int mouseX, int mouseY, int &gridX, int &gridY);
+        // Pending events as one batch in frameArena. waitMs > 0 sleeps
+        // until an event arrives or the timeout, for when nothing animates
+        void processEvents(Arena& frameArena, int waitMs = 0);
+        void handleCommand(const CommandEvent& event);
+        // Cell under a window position (row / col of the IsometricGrid), false if none
+        bool screenToGrid(int mouseX, int mouseY, int &gridX, int &gridY);
+
+        // Map editor
+        void setEditing(bool b);
+        void paintAt(int mouseX, int mouseY);
+        // Recolor the cells the editor changed, no full geometry rebuild
+        void applyEditedCells();
 
         // Window management
         void clear();
@@ -79,10 +158,23 @@ class SDLResources {
         // Grid (Main viewport)
         // Used to experiemente what how many grids I'll have on the screen
         void drawIsometricGridDefault(); 
-        // Used to convert what I have on my screen to an array containing info
+        // Fill the grid with the default map shape (what drawIsometricGridDefault
+        // shows) and save it to bleh.json
         void drawIsometricGridThenCreateGridObject();
         // Draw grid from 2d vector
+        void rebuildGridGeometry();
         void drawIsometricGrid();
+        // Same as above, rasterized on the CPU (software renderer)
+        void drawIsometricGridSoftware();
+        // Dim the cells viewerTeam can't see (updates cached colors)
+        void applyVisibility();
+        void updateCellColor(size_t i);
+        // Units of the attached battle, on top of the grid
+        void drawUnits();
+        // Top point of the cell a unit stands on, false if not drawn
+        bool unitScreenPos(const Sim::Unit& unit, int& x, int& y) const;
+        // Particles, one batch on top of everything (not while editing)
+        void drawEffects();
 
 };
 
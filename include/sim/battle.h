@@ -0,0 +1,116 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "sim/board.h"
+#include "sim/occupancy.h"
+#include "sim/rng.h"
+#include "sim/unit.h"
+#include "sim/varint.h"
+
+namespace Sim {
+
+    const int NO_TEAM = -1;
+
+    // Turn based battle on a Board. No SDL, no floats, no clocks: the
+    // outcome only depends on the board, the units, the seed and the
+    // actions applied, so it can run headless and be replayed.
+    // Plain value type, copy it to try things out.
+    class Battle {
+    private:
+        Board board;
+        std::vector<Unit> units;
+        Occupancy occupancy; // alive units only
+
+        // Play order (unit ids), fixed when the combat starts
+        std::vector<UnitId> turnOrder;
+        size_t activeIndex = 0;
+        uint32_t turn = 0; // full rounds played
+        bool started = false;
+
+        Rng rng;
+
+        // Undo journal for speculative play: while journaling, every change
+        // records the old value so rollback() costs what was touched, not
+        // a copy of the whole battle
+        struct JournalEntry {
+            enum Kind : uint8_t { CELL, UNIT, TURN } kind;
+            CellType cellType;   // CELL: old type
+            int cell;            // CELL: board index
+            Unit unit;           // UNIT: old value
+            size_t activeIndex;  // TURN: old values
+            uint32_t turn;
+            uint64_t rngState;
+        };
+        std::vector<JournalEntry> journal;
+        bool journaling = false;
+
+        void recordUnit(const Unit& unit);
+        void recordTurn();
+
+        void beginUnitTurn(Unit& unit);
+        void advanceTurn();
+
+        // isLegal(), cost gets the steps a legal MOVE takes
+        bool checkAction(const Action& action, int& cost) const;
+
+    public:
+        Battle() = default;
+        Battle(const Board& board, uint64_t seed);
+
+        // Getters
+        const Board& getBoard() const { return board; }
+        const std::vector<Unit>& getUnits() const { return units; }
+        const Unit& getUnit(UnitId id) const { return units[id]; }
+        uint32_t getTurn() const { return turn; }
+        Rng& getRng() { return rng; }
+        bool isStarted() const { return started; }
+
+        // Setup (before start()). NO_UNIT (nothing added) if the unit is
+        // alive and its cell is off the board or taken.
+        UnitId addUnit(Unit unit);
+
+        // Sort turn order (initiative, ties broken by the RNG) and give the
+        // first unit its points.
+        void start();
+
+        // Only valid when hasActiveUnit(): a battle with no unit placed
+        // (no spawn cell on the map) never starts
+        bool hasActiveUnit() const { return started && !turnOrder.empty(); }
+        const Unit& activeUnit() const { return units[turnOrder[activeIndex]]; }
+        UnitId unitAt(GridPos p) const { return occupancy.unitAt(p); }
+        const Occupancy& getOccupancy() const { return occupancy; }
+
+        // Number of steps to reach a cell for the active unit
+        // (-1 if unreachable within its move points)
+        int moveCost(GridPos to) const;
+
+        void legalActions(std::vector<Action>& out) const;
+        bool isLegal(const Action& action) const;
+
+        // Returns false (and changes nothing) if the action isn't legal
+        bool apply(const Action& action);
+
+        // Compact snapshot of everything that changes during a battle
+        // (cell types, units, turn order, RNG). Board size is not stored,
+        // loadState expects a battle on a board of the same size.
+        void saveState(std::vector<uint8_t>& out) const;
+        bool loadState(ByteReader& in);
+
+        // Change a cell during the battle (journaled)
+        void setCellType(GridPos p, CellType type);
+
+        // Speculation: turn journaling on, take a mark, try things with
+        // apply()/setCellType(), then rollback(mark) to undo them.
+        // Marks nest, rollback to an older mark undoes the newer ones too.
+        void setJournaling(bool on) { journaling = on; if (!on) journal.clear(); }
+        void reserveJournal(size_t entries) { journal.reserve(entries); }
+        size_t journalMark() const { return journal.size(); }
+        void rollback(size_t mark);
+
+        // Over once at most one team has units alive, or if there is nobody to play
+        bool isOver() const;
+        // Team of the last units standing, NO_TEAM while fighting or if nobody is left
+        int winningTeam() const;
+    };
+}
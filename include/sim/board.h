@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "grid_cell.h"
+
+class IsometricGrid;
+
+namespace Sim {
+
+    // Cell coordinates on the isometric lattice. Moving +1 col goes down-right
+    // on screen, +1 row goes down-left: the 4 neighbours share an edge.
+    struct GridPos {
+        int16_t row;
+        int16_t col;
+
+        bool operator==(const GridPos& o) const { return row == o.row && col == o.col; }
+        bool operator!=(const GridPos& o) const { return !(*this == o); }
+    };
+
+    const GridPos NEIGHBOURS[4] = { {-1, 0}, {0, 1}, {1, 0}, {0, -1} };
+
+    // Grid distance metric: number of steps between two cells (4 neighbours)
+    inline int distance(GridPos a, GridPos b) {
+        return std::abs(a.row - b.row) + std::abs(a.col - b.col);
+    }
+
+    // Cell types of a map, flat and without any screen data.
+    class Board {
+    private:
+        int width = 0;  // number of cols
+        int height = 0; // number of rows
+        std::vector<CellType> cells;
+
+    public:
+        Board() = default;
+        Board(int width, int height);
+
+        // Build the board from a loaded map, grid[row][col] is board cell (row, col)
+        static Board fromIsometricGrid(const IsometricGrid& isometricGrid);
+
+        // Getters
+        int getWidth() const { return width; }
+        int getHeight() const { return height; }
+        int getCellCount() const { return width * height; }
+
+        bool inBounds(GridPos p) const {
+            return p.row >= 0 && p.row < height && p.col >= 0 && p.col < width;
+        }
+        int index(GridPos p) const { return p.row * width + p.col; }
+        GridPos position(int idx) const {
+            return { static_cast<int16_t>(idx / width), static_cast<int16_t>(idx % width) };
+        }
+
+        CellType getCellType(GridPos p) const { return cells[index(p)]; }
+        CellType getCellType(int idx) const { return cells[idx]; }
+        bool isWalkable(GridPos p) const { return inBounds(p) && cells[index(p)] == WALKABLE; }
+        bool blocksSight(GridPos p) const { return !inBounds(p) || cells[index(p)] == OBSTACLE; }
+        bool hasSameCells(const Board& o) const {
+            return width == o.width && height == o.height && cells == o.cells;
+        }
+
+        // Setters
+        void setCellType(GridPos p, CellType type) { cells[index(p)] = type; }
+    };
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "sim/board.h"
+
+namespace Sim {
+
+    const uint16_t UNREACHABLE = 0xFFFF;
+
+    // Multi source distance map ("Dijkstra map") to a set of goal cells.
+    // Computed once for many units: each one then reads its next step in
+    // O(1) instead of running its own search. Buffers are kept between
+    // computes so a new field doesn't allocate.
+    class FlowField {
+    private:
+        int width = 0;
+        int height = 0;
+        std::vector<uint16_t> dist;  // steps to the closest goal
+        std::vector<int8_t> nextDir; // index in NEIGHBOURS, -1 = goal/unreachable
+
+        // Bucket queue (Dial): bucket d % BUCKET_COUNT holds cells at distance d
+        std::vector<std::vector<int>> buckets;
+
+    public:
+        // Cost to enter a cell, 0 = can't
+        static int stepCost(CellType type) { return type == WALKABLE ? 1 : 0; }
+        static const int MAX_STEP_COST = 1;
+        // Power of two > MAX_STEP_COST, enough buckets for the ring to never wrap onto itself
+        static const int BUCKET_COUNT = 2;
+
+        void compute(const Board& board, const std::vector<GridPos>& goals);
+
+        uint16_t distanceAt(GridPos p) const {
+            return (p.row >= 0 && p.row < height && p.col >= 0 && p.col < width) ? dist[p.row * width + p.col] : UNREACHABLE;
+        }
+
+        // Neighbour one step closer to the goals, false on a goal or unreachable cell
+        bool nextStep(GridPos from, GridPos& to) const {
+            const uint16_t d = distanceAt(from);
+            if (d == UNREACHABLE || d == 0) {
+                return false;
+            }
+            const GridPos step = NEIGHBOURS[nextDir[from.row * width + from.col]];
+            to = { static_cast<int16_t>(from.row + step.row), static_cast<int16_t>(from.col + step.col) };
+            return true;
+        }
+    };
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "arena.h"
+#include "sim/battle.h"
+
+namespace Sim {
+
+    struct MctsConfig {
+        int timeBudgetMs = 200;     // wall clock per decision
+        int threads = 0;            // 0 = one per core
+        uint32_t maxIterations = 0; // per thread, 0 = until the budget runs out
+        uint32_t rolloutRounds = 3; // rollouts stop after this many rounds and get evaluated
+        double exploration = 1.4;   // UCT constant
+        uint64_t seed = 1;
+    };
+
+    // Monte Carlo tree search over single actions of the active unit.
+    // Root parallelism: every thread grows its own tree (nodes in its own
+    // arena, no locking) from a copy of the battle, the root visit counts
+    // are summed at the end. Always returns within the time budget
+    // whatever the number of cores.
+    // Worker threads and their search state live as long as the AI, so a
+    // warmed up search doesn't touch the global heap.
+    // choose() blocks for the budget, a game loop uses startSearch() /
+    // pollResult() instead and keeps drawing while the workers think.
+    class MctsAi {
+    private:
+        struct ThreadContext; // one thread's arena, battle copy, scratch...
+        struct RootStat {
+            Action action;
+            uint64_t visits;
+        };
+
+        MctsConfig config;
+        std::vector<std::unique_ptr<ThreadContext>> contexts; // one per worker
+        std::vector<std::thread> workers;
+
+        // Job handoff to the workers
+        std::mutex mutex;
+        std::condition_variable wakeWorkers;
+        std::condition_variable workersDone;
+        uint64_t generation = 0; // bumped for every search
+        size_t running = 0;      // workers still searching
+        bool stopping = false;
+        const Battle* root = nullptr;
+        std::chrono::steady_clock::time_point deadline;
+
+        // Copy of the battle being searched, the caller's may change meanwhile
+        Battle rootBattle;
+        bool searching = false;  // started, result not collected yet
+        bool onlyChoice = false; // a single legal action, nothing to search
+
+        std::vector<Action> legal;
+        std::vector<RootStat> total;
+        uint64_t lastIterations = 0;
+
+        void workerLoop(size_t t);
+        void search(size_t t);
+        // Sum the root visits of every tree, most visited action wins
+        Action collectResult();
+
+    public:
+        explicit MctsAi(MctsConfig config = MctsConfig());
+        ~MctsAi();
+
+        MctsAi(const MctsAi&) = delete;
+        MctsAi& operator=(const MctsAi&) = delete;
+
+        // Blocks for the time budget. No search must be in flight.
+        Action choose(const Battle& battle);
+
+        // Background search: startSearch() returns right away (false if a
+        // search is already in flight), pollResult() is true once the best
+        // action is in `out`, then a new search can start.
+        bool startSearch(const Battle& battle);
+        bool pollResult(Action& out);
+        bool isSearching() const { return searching; }
+        // Wait for a search in flight and drop its result (battle restarted)
+        void discardSearch();
+
+        // Iterations of the last search, all threads together
+        uint64_t getLastIterations() const { return lastIterations; }
+    };
+}
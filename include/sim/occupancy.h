@@ -0,0 +1,68 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+
+#include "sim/board.h"
+#include "sim/unit.h"
+
+namespace Sim {
+
+    // Which unit stands where, both ways: a flat cell -> unit array and a
+    // unit -> cell array, kept in sync by place/move/remove.
+    // Lookups are O(1) and range queries only visit the cells in range.
+    class Occupancy {
+    private:
+        // Board size only, no pointer to it so copying a battle stays safe
+        int width = 0;
+        int height = 0;
+        std::vector<UnitId> cellToUnit;
+        std::vector<int> unitToCell; // -1 = not on the board
+
+    public:
+        Occupancy() = default;
+
+        // Empty index for a board (forgets every unit)
+        void reset(const Board& b);
+
+        // False (and nothing changes) if p is off the board or another
+        // unit stands there
+        bool place(UnitId id, GridPos p);
+        bool move(UnitId id, GridPos to);
+        void remove(UnitId id);
+
+        UnitId unitAt(GridPos p) const {
+            const bool inBounds = p.row >= 0 && p.row < height && p.col >= 0 && p.col < width;
+            return inBounds ? cellToUnit[p.row * width + p.col] : NO_UNIT;
+        }
+        bool isOccupied(GridPos p) const { return unitAt(p) != NO_UNIT; }
+        int cellOf(UnitId id) const {
+            return id < unitToCell.size() ? unitToCell[id] : -1;
+        }
+
+        // Calls f(UnitId) for every unit within `radius` steps of center
+        // (grid distance), visiting only the (2r+1)^2/2 cells of the diamond.
+        template <typename F>
+        void forEachInRange(GridPos center, int radius, F f) const {
+            for (int dr = -radius; dr <= radius; ++dr) {
+                const int row = center.row + dr;
+                if (row < 0 || row >= height) {
+                    continue;
+                }
+                const int span = radius - (dr < 0 ? -dr : dr);
+                const int colMin = std::max(0, center.col - span);
+                const int colMax = std::min(width - 1, center.col + span);
+                const UnitId* rowCells = &cellToUnit[row * width];
+                for (int col = colMin; col <= colMax; ++col) {
+                    if (rowCells[col] != NO_UNIT) {
+                        f(rowCells[col]);
+                    }
+                }
+            }
+        }
+
+        void unitsInRange(GridPos center, int radius, std::vector<UnitId>& out) const {
+            out.clear();
+            forEachInRange(center, radius, [&](UnitId id) { out.push_back(id); });
+        }
+    };
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sim/battle.h"
+#include "sim/varint.h"
+
+namespace Sim {
+
+    const std::string replaysFolder = "assets/replays/";
+
+    // Rounds between two snapshots: seeking replays at most this many rounds
+    const uint32_t SNAPSHOT_INTERVAL = 4;
+
+    // Reserved up front so recording a typical battle never reallocates
+    const size_t RESERVED_LOG_BYTES = 16 * 1024;
+    const size_t RESERVED_SNAPSHOTS = 64;
+    const size_t RESERVED_SNAPSHOT_BYTES = 64 * 1024;
+
+    // Append-only log of applied actions, one varint each:
+    // (target cell index << 2) | action type. END_TURN is a single 0 byte.
+    class ActionLog {
+    private:
+        int boardWidth = 0;
+        std::vector<uint8_t> bytes;
+        size_t count = 0;
+
+    public:
+        ActionLog() = default;
+        explicit ActionLog(int boardWidth) : boardWidth(boardWidth) {
+            bytes.reserve(RESERVED_LOG_BYTES);
+        }
+
+        void append(const Action& action);
+        static Action decode(ByteReader& in, int boardWidth);
+
+        const std::vector<uint8_t>& getBytes() const { return bytes; }
+        size_t getByteCount() const { return bytes.size(); }
+        size_t getCount() const { return count; }
+    };
+
+    // Records a battle while it is played: starting state, action log and a
+    // snapshot every SNAPSHOT_INTERVAL rounds, so seeking restores the
+    // closest snapshot and only re-applies the few actions after it.
+    class BattleRecorder {
+    private:
+        struct Snapshot {
+            uint32_t turn;
+            size_t step;      // actions applied before it
+            size_t logOffset; // where its actions start in the log
+            size_t stateOffset; // in snapshotBytes
+            size_t stateSize;
+        };
+
+        Battle initial;
+        ActionLog log;
+        std::vector<Snapshot> snapshots;
+        std::vector<uint8_t> snapshotBytes; // every snapshot state, back to back
+
+        // Closest snapshot at or before a point, restored into a battle.
+        // Returns the index of the snapshot used (-1 = initial state).
+        int restoreBefore(Battle& battle, uint32_t turn, size_t step) const;
+
+    public:
+        BattleRecorder() = default;
+        explicit BattleRecorder(const Battle& battle);
+
+        // Apply to the battle and record it, illegal actions are not recorded
+        bool apply(Battle& battle, const Action& action);
+
+        // Battle at the start of a round (end of the recording if past it)
+        Battle seekTurn(uint32_t turn) const;
+        // Battle after the first `step` actions
+        Battle seekStep(size_t step) const;
+
+        size_t getStepCount() const { return log.getCount(); }
+        size_t getSnapshotCount() const { return snapshots.size(); }
+        const ActionLog& getLog() const { return log; }
+
+        // Binary file in replaysFolder: board, starting state and the log.
+        // Snapshots are rebuilt when loading.
+        bool saveToFile(const std::string filename) const;
+        bool loadFromFile(const std::string filename);
+    };
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+
+namespace Sim {
+
+    // Small seeded RNG (xorshift64*). Same seed -> same battle on every
+    // platform, and it's a plain value so copying a battle copies its RNG.
+    class Rng {
+    private:
+        uint64_t state;
+
+    public:
+        explicit Rng(uint64_t seed = 0x9E3779B97F4A7C15ull) { reseed(seed); }
+
+        void reseed(uint64_t seed) {
+            // splitmix64 step so small seeds (0, 1, 2...) still give good states
+            uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            state = (z ^ (z >> 31)) | 1; // never 0
+        }
+
+        uint64_t getState() const { return state; }
+        void setState(uint64_t s) { state = s ? s : 1; } // 0 would get stuck
+
+        uint32_t next() {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return static_cast<uint32_t>((state * 0x2545F4914F6CDD1Dull) >> 32);
+        }
+
+        // Uniform in [0, n), n > 0 (Lemire's multiply + reject, no modulo bias)
+        uint32_t range(uint32_t n) {
+            uint64_t m = uint64_t(next()) * n;
+            uint32_t low = static_cast<uint32_t>(m);
+            if (low < n) {
+                const uint32_t threshold = static_cast<uint32_t>(-n) % n;
+                while (low < threshold) {
+                    m = uint64_t(next()) * n;
+                    low = static_cast<uint32_t>(m);
+                }
+            }
+            return static_cast<uint32_t>(m >> 32);
+        }
+
+        // Uniform in [min, max]
+        int between(int min, int max) {
+            return min + static_cast<int>(range(static_cast<uint32_t>(max - min + 1)));
+        }
+    };
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "sim/battle.h"
+#include "sim/flow_field.h"
+
+namespace Sim {
+
+    // Battles are stopped after this many rounds and count as a draw
+    const uint32_t MAX_TURNS = 100;
+
+    // Spawn zones: top third of the board for team 0, bottom third for team 1
+    inline bool inSpawnZone(const Board& board, int team, GridPos p) {
+        const int third = board.getHeight() / 3;
+        return (team == 0) ? p.row < third : p.row >= board.getHeight() - third;
+    }
+
+    // Place unitsPerTeam units of each team in its spawn zone, on random
+    // (seeded) free walkable cells.
+    void setupSkirmish(Battle& battle, int unitsPerTeam);
+
+    // Simple deterministic policy: hit the weakest enemy in range, otherwise
+    // follow the flow field towards the closest enemy, otherwise end the turn.
+    // One flow field per team and per round, shared by all its units. The
+    // fields of the last FIELD_ROUNDS rounds are kept, a search going back
+    // and forth between rounds (MCTS rollouts) computes each one once.
+    class GreedyAi {
+    private:
+        static const uint32_t FIELD_ROUNDS = 8; // slot = round % FIELD_ROUNDS
+
+        std::vector<Action> scratch;
+        std::vector<GridPos> goals;
+
+        FlowField fields[2][FIELD_ROUNDS];
+        uint32_t fieldTurns[2][FIELD_ROUNDS] = {}; // round each field was computed for
+        bool fieldValid[2][FIELD_ROUNDS] = {};
+
+        const FlowField& fieldFor(const Battle& battle, int team);
+
+    public:
+        Action choose(const Battle& battle);
+
+        // Forget the cached fields (when switching to an unrelated battle state)
+        void reset() { std::fill(&fieldValid[0][0], &fieldValid[0][0] + 2 * FIELD_ROUNDS, false); }
+    };
+
+    // Play a started battle to the end with GreedyAi for every unit.
+    // Returns the winning team (NO_TEAM for a draw).
+    int playOut(Battle& battle);
+}
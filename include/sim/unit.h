@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+
+#include "sim/board.h"
+
+namespace Sim {
+
+    typedef uint16_t UnitId;
+    const UnitId NO_UNIT = 0xFFFF;
+
+    struct Unit {
+        UnitId id = NO_UNIT;
+        uint8_t team = 0;
+        GridPos pos = {0, 0};
+
+        int16_t hp = 0;
+        int16_t maxHp = 0;
+        int16_t attack = 0;   // base damage, rolled +/- 20%
+        int8_t range = 1;     // attack range in cells
+        int8_t initiative = 0; // higher plays first
+
+        // Points for the current turn, refilled at the start of each turn
+        int8_t movePoints = 0;
+        int8_t actionPoints = 0;
+        int8_t maxMovePoints = 3;
+        int8_t maxActionPoints = 6;
+        int8_t attackCost = 3;
+
+        bool isAlive() const { return hp > 0; }
+    };
+
+    enum ActionType : uint8_t {
+        END_TURN,
+        MOVE,
+        ATTACK
+    };
+
+    // Everything the active unit can do during its turn.
+    // The unit acting is always the battle's active unit.
+    struct Action {
+        ActionType type = END_TURN;
+        GridPos target = {0, 0}; // MOVE: destination, ATTACK: target cell
+
+        static Action endTurn() { return Action(); }
+        static Action move(GridPos to) { Action a; a.type = MOVE; a.target = to; return a; }
+        static Action attackAt(GridPos at) { Action a; a.type = ATTACK; a.target = at; return a; }
+    };
+}
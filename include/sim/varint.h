@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Sim {
+
+    // LEB128 style varints: 7 bits per byte, high bit = more bytes follow.
+    // Small numbers (most of what a battle stores) take a single byte.
+    class ByteWriter {
+    private:
+        std::vector<uint8_t>& out;
+
+    public:
+        explicit ByteWriter(std::vector<uint8_t>& out) : out(out) {}
+
+        void writeByte(uint8_t b) { out.push_back(b); }
+
+        void writeVarint(uint64_t v) {
+            while (v >= 0x80) {
+                out.push_back(static_cast<uint8_t>(v | 0x80));
+                v >>= 7;
+            }
+            out.push_back(static_cast<uint8_t>(v));
+        }
+
+        // Signed values, zigzag encoded so small negatives stay small
+        void writeSigned(int64_t v) {
+            writeVarint((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+        }
+
+        size_t size() const { return out.size(); }
+    };
+
+    // Reads what ByteWriter wrote. Running past the end sets the error flag
+    // and returns 0 instead of reading garbage.
+    class ByteReader {
+    private:
+        const uint8_t* data;
+        size_t length;
+        size_t offset = 0;
+        bool failed = false;
+
+    public:
+        ByteReader(const uint8_t* data, size_t length) : data(data), length(length) {}
+        explicit ByteReader(const std::vector<uint8_t>& bytes) : data(bytes.data()), length(bytes.size()) {}
+
+        bool ok() const { return !failed; }
+        bool atEnd() const { return offset >= length; }
+        size_t getOffset() const { return offset; }
+        void seek(size_t o) { offset = o; }
+
+        uint8_t readByte() {
+            if (offset >= length) {
+                failed = true;
+                return 0;
+            }
+            return data[offset++];
+        }
+
+        uint64_t readVarint() {
+            uint64_t v = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                const uint8_t b = readByte();
+                v |= uint64_t(b & 0x7F) << shift;
+                if (!(b & 0x80)) {
+                    return v;
+                }
+            }
+            failed = true;
+            return 0;
+        }
+
+        int64_t readSigned() {
+            const uint64_t v = readVarint();
+            return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+        }
+    };
+}
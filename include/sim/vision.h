@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "sim/battle.h"
+
+namespace Sim {
+
+    const int DEFAULT_SIGHT_RADIUS = 8;
+
+    // Per team visible cells (fog of war). Line of sight uses recursive
+    // shadowcasting against OBSTACLE cells, limited to the grid distance.
+    // Results are kept per unit and per team cell counters, so update()
+    // only re-casts for units that moved/died and for units near a cell
+    // that started or stopped blocking sight (update() spots those by
+    // diffing the board's opaque cells, or cellChanged() reports them).
+    class Vision {
+    private:
+        struct UnitSight {
+            int origin = -1;        // cell it was cast from, -1 = not cast
+            bool dirty = true;
+            std::vector<int> cells; // cells it sees
+        };
+
+        int width = 0;
+        int height = 0;
+        int sightRadius = DEFAULT_SIGHT_RADIUS;
+
+        std::vector<UnitSight> sights;             // per unit
+        std::vector<std::vector<uint16_t>> seenBy; // per team, units seeing each cell
+        std::vector<std::vector<uint64_t>> visible; // per team bitset, seenBy > 0
+        uint32_t revision = 0;
+
+        // Cells blocking sight when the sights were last cast (bitset), and
+        // scratch for the board's current ones
+        std::vector<uint64_t> opaque;
+        std::vector<uint64_t> opaqueNow;
+
+        // Dedupe while casting (octants overlap on their edges)
+        std::vector<uint32_t> castStamp;
+        uint32_t castGeneration = 0;
+
+        void ensureTeam(int team);
+        // cellChanged() for every cell whose opacity differs from last update
+        void detectCellChanges(const Board& board);
+        void addSight(int team, const std::vector<int>& cells);
+        void removeSight(int team, const std::vector<int>& cells);
+        void cast(const Board& board, GridPos origin, std::vector<int>& out);
+        void castOctant(const Board& board, GridPos origin, int row, double start, double end,
+                        int xx, int xy, int yx, int yy, std::vector<int>& out);
+
+    public:
+        Vision() = default;
+        Vision(const Board& board, int sightRadius = DEFAULT_SIGHT_RADIUS);
+
+        // Bring every team up to date with the battle, re-casting only what
+        // changed (units that moved, cells that changed type)
+        void update(const Battle& battle);
+
+        // A cell changed type (obstacle added/removed): units that could see
+        // it re-cast on the next update()
+        void cellChanged(GridPos p);
+
+        bool isVisible(int team, int idx) const {
+            if (team < 0 || team >= static_cast<int>(visible.size())) {
+                return false;
+            }
+            return (visible[team][idx >> 6] >> (idx & 63)) & 1;
+        }
+        const std::vector<uint64_t>& getVisibleBits(int team) const { return visible[team]; }
+
+        // Bumped every time a visible set changes, for cheap change detection
+        uint32_t getRevision() const { return revision; }
+        int getSightRadius() const { return sightRadius; }
+    };
+}
@@ -0,0 +1,37 @@
+#ifndef SOFT_RASTERIZER_H
+#define SOFT_RASTERIZER_H
+
+#include <cstdint>
+
+// CPU rasterizer used when SDL falls back to its software renderer
+// (headless / no GPU). Writes straight into a locked 32 bit pixel buffer
+// (ARGB8888), so a whole grid costs one texture upload instead of
+// thousands of SDL_RenderDrawLine calls.
+class SoftRasterizer {
+
+    private:
+        uint32_t* pixels = nullptr;
+        int pitch = 0; // in pixels, not bytes
+        int width = 0;
+        int height = 0;
+
+        // Fill [x0, x1] (inclusive) of a row, already clipped
+        static void fillSpan(uint32_t* row, int x0, int x1, uint32_t color);
+
+    public:
+        // Pack a color the same way SDL_PIXELFORMAT_ARGB8888 stores it
+        static uint32_t packColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 0xFF) {
+            return (uint32_t(a) << 24) | (uint32_t(r) << 16) | (uint32_t(g) << 8) | uint32_t(b);
+        }
+
+        // Bind the buffer returned by SDL_LockTexture / SDL_Surface::pixels
+        void setTarget(void* buffer, int pitchBytes, int w, int h);
+
+        void clear(uint32_t color);
+
+        // Same geometry as SDLResources::drawFilledDiamond: (x, y) is the top
+        // point. The outline is drawn in the same pass as the fill.
+        void fillDiamond(int x, int y, int w, int h, uint32_t fill, uint32_t outline);
+};
+
+#endif // SOFT_RASTERIZER_H
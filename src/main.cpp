@@ -1,4 +1,5 @@
 // C++ Standard Libraries
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <stdio.h>
@@ -7,7 +8,15 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
+#include "arena.h"
+#include "instrumentation.h"
+#include "particles.h"
 #include "sdl_utils.h"
+#include "sim/battle.h"
+#include "sim/mcts.h"
+#include "sim/replay.h"
+#include "sim/scenario.h"
+#include "sim/vision.h"
 
 // Window name
 const char* WINDOW_NAME = "SDL2 Tactics";
@@ -16,6 +25,25 @@ const char* WINDOW_NAME = "SDL2 Tactics";
 const float BASE_WINDOW_WIDTH = 1280;
 const float BASE_WINDOW_HEIGHT = 720;
 
+// Battle settings
+const uint64_t BATTLE_SEED = 42;
+const int UNITS_PER_TEAM = 4;
+const Uint32 ACTION_DELAY_MS = 250; // so we can follow what happens
+const int PLAYER_TEAM = 0;
+const int ENEMY_TIME_BUDGET_MS = 200; // thinking time per enemy action
+const int SEARCH_POLL_MS = 16; // how often a running enemy search gets checked
+
+// Longest sleep waiting for events when nothing animates (editor autosave
+// still gets checked at that rate)
+const int IDLE_WAIT_MS = 500;
+
+// Frame interval while effects animate (~60 fps)
+const int EFFECT_FRAME_MS = 16;
+const float SMOKE_SECONDS = 1.5f; // over a unit that just died
+
+// Scratch memory, reset every loop iteration
+const size_t FRAME_ARENA_SIZE = 256 * 1024;
+
 int main(int argc, char *args[])
 {
 
@@ -24,15 +52,193 @@ int main(int argc, char *args[])
 	// load map
 	sdl.loadMap("test_map.json");
 
+	// Battle simulation, doesn't know about SDL, we only draw it
+	Sim::Battle battle;
+	// Everything applied goes through the recorder so the battle can be replayed
+	Sim::BattleRecorder recorder;
+	// Fog of war, what the player's team sees
+	Sim::Vision vision;
+
+	// Enemies search, the player's team still plays the placeholder AI
+	Sim::GreedyAi playerAi;
+	Sim::MctsConfig enemyConfig;
+	enemyConfig.timeBudgetMs = ENEMY_TIME_BUDGET_MS;
+	enemyConfig.seed = BATTLE_SEED;
+	Sim::MctsAi enemyAi(enemyConfig);
+
+	// Effects are drawn by SDLResources, the game loop spawns and updates them
+	ParticleSystem& effects = sdl.getEffects();
+	ParticleSystem::Emitter* activeMarker = nullptr;
+
+	// Aura over the unit playing, only when the player's team can see it
+	auto markActiveUnit = [&]()
+	{
+		const bool show = battle.hasActiveUnit() && !battle.isOver() && battle.getTurn() < Sim::MAX_TURNS &&
+			vision.isVisible(PLAYER_TEAM, battle.getBoard().index(battle.activeUnit().pos));
+		if (!show)
+		{
+			if (activeMarker)
+			{
+				effects.stopEmitter(activeMarker);
+				activeMarker = nullptr;
+			}
+			return;
+		}
+		const Sim::GridPos at = battle.activeUnit().pos;
+		if (activeMarker)
+		{
+			effects.moveEmitter(activeMarker, at.row, at.col);
+		}
+		else
+		{
+			activeMarker = effects.startEmitter(EFFECT_AURA, at.row, at.col);
+		}
+	};
+
+	// Effects of an applied action, target is who stood on the attacked cell
+	auto playActionEffects = [&](const Sim::Action& action, Sim::UnitId target)
+	{
+		const Sim::GridPos at = action.target;
+		if (action.type == Sim::END_TURN || !vision.isVisible(PLAYER_TEAM, battle.getBoard().index(at)))
+		{
+			return;
+		}
+		if (action.type == Sim::MOVE)
+		{
+			effects.burst(EFFECT_DUST, at.row, at.col);
+			return;
+		}
+		effects.burst(EFFECT_HIT, at.row, at.col);
+		if (target != Sim::NO_UNIT && !battle.getUnit(target).isAlive())
+		{
+			effects.startEmitter(EFFECT_SMOKE, at.row, at.col, SMOKE_SECONDS);
+		}
+	};
+
+	// Map the battle was started on
+	Sim::Board battleBoard;
+
+	// New battle on the current map (at launch and after the map was edited)
+	auto startBattle = [&]()
+	{
+		battleBoard = Sim::Board::fromIsometricGrid(sdl.getIsometricGrid());
+		battle = Sim::Battle(battleBoard, BATTLE_SEED);
+		Sim::setupSkirmish(battle, UNITS_PER_TEAM);
+		battle.start();
+		sdl.setBattle(&battle);
+
+		recorder = Sim::BattleRecorder(battle);
+
+		vision = Sim::Vision(battle.getBoard());
+		vision.update(battle);
+		sdl.setVision(&vision, PLAYER_TEAM);
+
+		playerAi.reset();
+		enemyAi.discardSearch(); // was thinking about the previous battle
+
+		effects.clear();
+		activeMarker = nullptr;
+		markActiveUnit();
+	};
+	startBattle();
+
+	// The editor pauses the battle, map revision it was started on
+	uint64_t battleMapRevision = sdl.getMapEditor().getRevision();
+
+	Uint32 lastActionTime = SDL_GetTicks();
+
+	// Frame scratch memory: anything that only lives for a frame (input
+	// commands) goes here instead of the heap. Per round scratch (AI
+	// buffers, flow fields) is kept in the AIs and reused.
+	Arena frameArena(FRAME_ARENA_SIZE);
+	Instrumentation::track("frame arena", frameArena);
+	Instrumentation::track("particles", effects);
+	Instrumentation::trackMemory("effect emitters", &effects, [](const void* o)
+		{ return static_cast<const ParticleSystem*>(o)->getEmitterStats(); });
+
+	Uint32 lastFrameTime = SDL_GetTicks();
 	
 	// Main loop
 	while (!sdl.getQuit())
 	{
-		// Handle events
-		sdl.processEvents();
+		Instrumentation::beginFrame();
+		frameArena.reset();
+
+		// Handle events, sleeping until the next battle action / an
+		// event when there is nothing else to do
+		int waitMs = IDLE_WAIT_MS;
+		if (!sdl.isEditing() && !battle.isOver() && battle.getTurn() < Sim::MAX_TURNS)
+		{
+			const Uint32 elapsed = SDL_GetTicks() - lastActionTime;
+			waitMs = (elapsed >= ACTION_DELAY_MS) ? 0 : static_cast<int>(ACTION_DELAY_MS - elapsed);
+			// Waiting for the enemy's search, no need to spin
+			if (waitMs == 0 && enemyAi.isSearching())
+			{
+				waitMs = SEARCH_POLL_MS;
+			}
+		}
+		if (!sdl.isEditing() && !effects.isIdle())
+		{
+			waitMs = std::min(waitMs, EFFECT_FRAME_MS);
+		}
+		sdl.processEvents(frameArena, waitMs);
 
 		// Game Logic
-		// TODO
+		// Back from the editor with a different map: start over on it. Edits
+		// undone back to the same map leave the battle going.
+		if (!sdl.isEditing() && sdl.getMapEditor().getRevision() != battleMapRevision)
+		{
+			battleMapRevision = sdl.getMapEditor().getRevision();
+			if (!Sim::Board::fromIsometricGrid(sdl.getIsometricGrid()).hasSameCells(battleBoard))
+			{
+				startBattle();
+				lastActionTime = SDL_GetTicks();
+			}
+		}
+
+		// One action at a time
+		if (!sdl.isEditing() && battle.hasActiveUnit() && !battle.isOver() && battle.getTurn() < Sim::MAX_TURNS)
+		{
+			if (SDL_GetTicks() - lastActionTime >= ACTION_DELAY_MS)
+			{
+				Sim::Action action;
+				bool ready = true;
+				if (battle.activeUnit().team != PLAYER_TEAM)
+				{
+					ready = enemyAi.pollResult(action);
+				}
+				else
+				{
+					action = playerAi.choose(battle);
+				}
+
+				if (ready)
+				{
+					const Sim::UnitId target = (action.type == Sim::ATTACK) ? battle.unitAt(action.target) : Sim::NO_UNIT;
+					recorder.apply(battle, action);
+					vision.update(battle);
+					playActionEffects(action, target);
+					markActiveUnit();
+					lastActionTime = SDL_GetTicks();
+				}
+			}
+		}
+
+		// Enemies search in the background from the start of their turn,
+		// the loop keeps drawing while they think
+		if (!sdl.isEditing() && battle.hasActiveUnit() && !battle.isOver() && battle.getTurn() < Sim::MAX_TURNS &&
+			battle.activeUnit().team != PLAYER_TEAM && !enemyAi.isSearching())
+		{
+			enemyAi.startSearch(battle);
+		}
+
+		// Effects are paused with the battle while editing
+		const Uint32 now = SDL_GetTicks();
+		if (!sdl.isEditing())
+		{
+			effects.update((now - lastFrameTime) / 1000.0f);
+		}
+		lastFrameTime = now;
 
 		// Clear the renderer with white background
 		sdl.setDrawColor(255, 255, 255, 255);
@@ -43,6 +249,15 @@ int main(int argc, char *args[])
 		
 		// Update the screen
 		sdl.present();
+
+		Instrumentation::endFrame();
+	}
+
+	Instrumentation::printReport();
+
+	if (recorder.saveToFile("last_battle.replay"))
+	{
+		std::cout << "Replay saved successfully!" << std::endl;
 	}
 	
 	return 0;
@@ -0,0 +1,437 @@
+#include <algorithm>
+#include <cassert>
+
+#include "sim/battle.h"
+
+namespace Sim {
+
+// Scratch for the move flood fill, reused between calls
+static thread_local std::vector<int8_t> moveDistance;
+static thread_local std::vector<int> moveQueue;
+
+// Breadth first flood from the active unit over free walkable cells, up to
+// its move points. Fills moveDistance (-1 = unreachable) and moveQueue with
+// every reached cell except the start.
+static void floodMoves(const Battle& battle) {
+    const Board& board = battle.getBoard();
+    const Unit& unit = battle.activeUnit();
+
+    moveDistance.assign(board.getCellCount(), -1);
+    moveQueue.clear();
+
+    const int start = board.index(unit.pos);
+    moveDistance[start] = 0;
+    moveQueue.push_back(start);
+
+    for (size_t head = 0; head < moveQueue.size(); ++head) {
+        const int current = moveQueue[head];
+        const int8_t dist = moveDistance[current];
+        if (dist >= unit.movePoints) {
+            continue;
+        }
+        const GridPos p = board.position(current);
+        for (const GridPos& d : NEIGHBOURS) {
+            const GridPos n = { static_cast<int16_t>(p.row + d.row), static_cast<int16_t>(p.col + d.col) };
+            if (!board.isWalkable(n)) {
+                continue;
+            }
+            const int idx = board.index(n);
+            if (moveDistance[idx] != -1 || battle.getOccupancy().isOccupied(n)) {
+                continue;
+            }
+            moveDistance[idx] = dist + 1;
+            moveQueue.push_back(idx);
+        }
+    }
+    moveQueue.erase(moveQueue.begin());
+}
+
+Battle::Battle(const Board& board, uint64_t seed) : board(board), rng(seed) {
+    occupancy.reset(this->board);
+}
+
+UnitId Battle::addUnit(Unit unit) {
+    unit.id = static_cast<UnitId>(units.size());
+    if (unit.isAlive() && !occupancy.place(unit.id, unit.pos)) {
+        return NO_UNIT;
+    }
+    units.push_back(unit);
+    return unit.id;
+}
+
+void Battle::start() {
+    turnOrder.clear();
+    for (const Unit& unit : units) {
+        turnOrder.push_back(unit.id);
+    }
+
+    // Initiative first, equal initiatives get a random (seeded) order
+    std::vector<uint32_t> tieBreak(units.size());
+    for (uint32_t& t : tieBreak) {
+        t = rng.next();
+    }
+    std::sort(turnOrder.begin(), turnOrder.end(), [&](UnitId a, UnitId b) {
+        if (units[a].initiative != units[b].initiative) {
+            return units[a].initiative > units[b].initiative;
+        }
+        return tieBreak[a] < tieBreak[b];
+    });
+
+    activeIndex = 0;
+    turn = 0;
+    if (turnOrder.empty()) {
+        started = false; // nobody to play, isOver() already
+        return;
+    }
+    started = true;
+    if (!units[turnOrder[activeIndex]].isAlive()) {
+        advanceTurn();
+    }
+    else {
+        beginUnitTurn(units[turnOrder[activeIndex]]);
+    }
+}
+
+void Battle::recordUnit(const Unit& unit) {
+    if (journaling) {
+        JournalEntry entry;
+        entry.kind = JournalEntry::UNIT;
+        entry.unit = unit;
+        journal.push_back(entry);
+    }
+}
+
+void Battle::recordTurn() {
+    if (journaling) {
+        JournalEntry entry;
+        entry.kind = JournalEntry::TURN;
+        entry.activeIndex = activeIndex;
+        entry.turn = turn;
+        entry.rngState = rng.getState();
+        journal.push_back(entry);
+    }
+}
+
+void Battle::setCellType(GridPos p, CellType type) {
+    if (journaling) {
+        JournalEntry entry;
+        entry.kind = JournalEntry::CELL;
+        entry.cell = board.index(p);
+        entry.cellType = board.getCellType(p);
+        journal.push_back(entry);
+    }
+    board.setCellType(p, type);
+}
+
+void Battle::rollback(size_t mark) {
+    while (journal.size() > mark) {
+        const JournalEntry& entry = journal.back();
+        switch (entry.kind) {
+            case JournalEntry::CELL:
+                board.setCellType(board.position(entry.cell), entry.cellType);
+                break;
+            case JournalEntry::UNIT: {
+                Unit& unit = units[entry.unit.id];
+                if (unit.isAlive()) {
+                    occupancy.remove(unit.id);
+                }
+                unit = entry.unit;
+                // Undone newest first: whoever took the cell since has left it already
+                const bool placed = !unit.isAlive() || occupancy.place(unit.id, unit.pos);
+                assert(placed);
+                (void)placed;
+                break;
+            }
+            case JournalEntry::TURN:
+                activeIndex = entry.activeIndex;
+                turn = entry.turn;
+                rng.setState(entry.rngState);
+                break;
+        }
+        journal.pop_back();
+    }
+}
+
+void Battle::beginUnitTurn(Unit& unit) {
+    recordUnit(unit);
+    unit.movePoints = unit.maxMovePoints;
+    unit.actionPoints = unit.maxActionPoints;
+}
+
+void Battle::advanceTurn() {
+    for (size_t i = 0; i < turnOrder.size(); ++i) {
+        if (++activeIndex == turnOrder.size()) {
+            activeIndex = 0;
+            ++turn;
+        }
+        Unit& next = units[turnOrder[activeIndex]];
+        if (next.isAlive()) {
+            beginUnitTurn(next);
+            return;
+        }
+    }
+}
+
+int Battle::moveCost(GridPos to) const {
+    if (!hasActiveUnit() || !board.isWalkable(to) || activeUnit().movePoints <= 0) {
+        return -1;
+    }
+    floodMoves(*this);
+    const int dist = moveDistance[board.index(to)];
+    return dist > 0 ? dist : -1;
+}
+
+void Battle::legalActions(std::vector<Action>& out) const {
+    out.clear();
+    out.push_back(Action::endTurn());
+    if (!hasActiveUnit() || isOver()) {
+        return;
+    }
+
+    const Unit& unit = activeUnit();
+    if (unit.movePoints > 0) {
+        floodMoves(*this);
+        for (int idx : moveQueue) {
+            out.push_back(Action::move(board.position(idx)));
+        }
+    }
+
+    if (unit.actionPoints >= unit.attackCost) {
+        occupancy.forEachInRange(unit.pos, unit.range, [&](UnitId id) {
+            if (units[id].team != unit.team) {
+                out.push_back(Action::attackAt(units[id].pos));
+            }
+        });
+    }
+}
+
+bool Battle::isLegal(const Action& action) const {
+    int cost;
+    return checkAction(action, cost);
+}
+
+bool Battle::checkAction(const Action& action, int& cost) const {
+    cost = 0;
+    if (!hasActiveUnit()) {
+        return false;
+    }
+    const Unit& unit = activeUnit();
+    switch (action.type) {
+        case END_TURN:
+            return true;
+        case MOVE:
+            cost = isOver() ? -1 : moveCost(action.target);
+            return cost > 0;
+        case ATTACK: {
+            if (isOver() || unit.actionPoints < unit.attackCost || distance(unit.pos, action.target) > unit.range) {
+                return false;
+            }
+            const UnitId target = unitAt(action.target);
+            return target != NO_UNIT && units[target].team != unit.team;
+        }
+    }
+    return false;
+}
+
+bool Battle::apply(const Action& action) {
+    // A move's cost comes out of the check, one flood fill per move
+    int cost;
+    if (!checkAction(action, cost)) {
+        return false;
+    }
+
+    Unit& unit = units[turnOrder[activeIndex]];
+    recordTurn();
+    switch (action.type) {
+        case END_TURN:
+            advanceTurn();
+            break;
+        case MOVE:
+            recordUnit(unit);
+            unit.movePoints -= static_cast<int8_t>(cost);
+            unit.pos = action.target;
+            occupancy.move(unit.id, unit.pos); // free, checkAction() flooded through it
+            break;
+        case ATTACK: {
+            Unit& target = units[unitAt(action.target)];
+            recordUnit(target);
+            recordUnit(unit);
+            // +/- 20% in integer percent, keeps results bit exact everywhere
+            const int damage = (unit.attack * rng.between(80, 120)) / 100;
+            target.hp = static_cast<int16_t>(std::max(0, target.hp - damage));
+            if (!target.isAlive()) {
+                occupancy.remove(target.id);
+            }
+            unit.actionPoints -= unit.attackCost;
+            break;
+        }
+    }
+    return true;
+}
+
+bool Battle::isOver() const {
+    if (turnOrder.empty()) {
+        return true; // not started, or started without units
+    }
+    int team = NO_TEAM;
+    for (const Unit& unit : units) {
+        if (!unit.isAlive()) {
+            continue;
+        }
+        if (team == NO_TEAM) {
+            team = unit.team;
+        }
+        else if (team != unit.team) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int Battle::winningTeam() const {
+    if (!isOver()) {
+        return NO_TEAM;
+    }
+    for (const Unit& unit : units) {
+        if (unit.isAlive()) {
+            return unit.team;
+        }
+    }
+    return NO_TEAM;
+}
+
+void Battle::saveState(std::vector<uint8_t>& out) const {
+    ByteWriter writer(out);
+
+    // Cell types, 2 bits each
+    uint8_t packed = 0;
+    for (int idx = 0; idx < board.getCellCount(); ++idx) {
+        packed |= static_cast<uint8_t>(board.getCellType(idx) & 0x3) << ((idx % 4) * 2);
+        if (idx % 4 == 3 || idx == board.getCellCount() - 1) {
+            writer.writeByte(packed);
+            packed = 0;
+        }
+    }
+
+    writer.writeVarint(units.size());
+    for (const Unit& unit : units) {
+        writer.writeByte(unit.team);
+        writer.writeVarint(board.index(unit.pos));
+        writer.writeSigned(unit.hp);
+        writer.writeSigned(unit.maxHp);
+        writer.writeSigned(unit.attack);
+        writer.writeSigned(unit.range);
+        writer.writeSigned(unit.initiative);
+        writer.writeSigned(unit.movePoints);
+        writer.writeSigned(unit.actionPoints);
+        writer.writeSigned(unit.maxMovePoints);
+        writer.writeSigned(unit.maxActionPoints);
+        writer.writeSigned(unit.attackCost);
+    }
+
+    // Empty until start()
+    writer.writeVarint(turnOrder.size());
+    for (UnitId id : turnOrder) {
+        writer.writeVarint(id);
+    }
+    writer.writeVarint(activeIndex);
+    writer.writeVarint(turn);
+    writer.writeByte(started ? 1 : 0);
+    writer.writeVarint(rng.getState());
+}
+
+bool Battle::loadState(ByteReader& in) {
+    // Everything is decoded and checked first, a corrupt snapshot leaves
+    // the battle as it was
+    const int cellCount = board.getCellCount();
+    std::vector<CellType> cellTypes(cellCount);
+    uint8_t packed = 0;
+    for (int idx = 0; idx < cellCount; ++idx) {
+        if (idx % 4 == 0) {
+            packed = in.readByte();
+        }
+        cellTypes[idx] = static_cast<CellType>((packed >> ((idx % 4) * 2)) & 0x3);
+    }
+
+    // At most one unit per cell
+    const uint64_t unitCount = in.readVarint();
+    if (!in.ok() || unitCount > static_cast<uint64_t>(cellCount)) {
+        return false;
+    }
+    std::vector<Unit> newUnits(static_cast<size_t>(unitCount));
+    for (size_t i = 0; i < newUnits.size() && in.ok(); ++i) {
+        Unit& unit = newUnits[i];
+        unit.id = static_cast<UnitId>(i);
+        unit.team = in.readByte();
+        const uint64_t cell = in.readVarint();
+        if (cell >= static_cast<uint64_t>(cellCount)) {
+            return false;
+        }
+        unit.pos = board.position(static_cast<int>(cell));
+        unit.hp = static_cast<int16_t>(in.readSigned());
+        unit.maxHp = static_cast<int16_t>(in.readSigned());
+        unit.attack = static_cast<int16_t>(in.readSigned());
+        unit.range = static_cast<int8_t>(in.readSigned());
+        unit.initiative = static_cast<int8_t>(in.readSigned());
+        unit.movePoints = static_cast<int8_t>(in.readSigned());
+        unit.actionPoints = static_cast<int8_t>(in.readSigned());
+        unit.maxMovePoints = static_cast<int8_t>(in.readSigned());
+        unit.maxActionPoints = static_cast<int8_t>(in.readSigned());
+        unit.attackCost = static_cast<int8_t>(in.readSigned());
+    }
+
+    // Empty before start(), every unit exactly once after
+    const uint64_t orderCount = in.readVarint();
+    if (!in.ok() || (orderCount != 0 && orderCount != newUnits.size())) {
+        return false;
+    }
+    std::vector<UnitId> newTurnOrder(static_cast<size_t>(orderCount));
+    std::vector<uint8_t> ordered(newUnits.size(), 0);
+    for (UnitId& id : newTurnOrder) {
+        const uint64_t value = in.readVarint();
+        if (value >= newUnits.size() || ordered[value]) {
+            return false;
+        }
+        ordered[value] = 1;
+        id = static_cast<UnitId>(value);
+    }
+    const uint64_t newActiveIndex = in.readVarint();
+    const uint32_t newTurn = static_cast<uint32_t>(in.readVarint());
+    const bool newStarted = in.readByte() != 0;
+    const uint64_t rngState = in.readVarint();
+    if (!in.ok() || (!newTurnOrder.empty() && newActiveIndex >= newTurnOrder.size())) {
+        return false;
+    }
+    // A started battle always has someone to play (start() doesn't start without units)
+    if (newStarted && newTurnOrder.empty()) {
+        return false;
+    }
+
+    // Alive units stand on walkable cells, one per cell, or the index
+    // wouldn't match the units
+    Occupancy newOccupancy;
+    newOccupancy.reset(board);
+    for (const Unit& unit : newUnits) {
+        if (!unit.isAlive()) {
+            continue;
+        }
+        if (cellTypes[board.index(unit.pos)] != WALKABLE || !newOccupancy.place(unit.id, unit.pos)) {
+            return false;
+        }
+    }
+
+    for (int idx = 0; idx < cellCount; ++idx) {
+        board.setCellType(board.position(idx), cellTypes[idx]);
+    }
+    units = std::move(newUnits);
+    turnOrder = std::move(newTurnOrder);
+    activeIndex = static_cast<size_t>(newActiveIndex);
+    turn = newTurn;
+    started = newStarted;
+    rng.setState(rngState);
+    occupancy = std::move(newOccupancy);
+    journal.clear();
+    return true;
+}
+
+}
@@ -0,0 +1,23 @@
+#include "isometric_grid.h"
+#include "sim/board.h"
+
+namespace Sim {
+
+Board::Board(int width, int height)
+    : width(width), height(height),
+      cells(width * height, NO_RENDER) {}
+
+Board Board::fromIsometricGrid(const IsometricGrid& isometricGrid) {
+    const std::vector<std::vector<GridCell>>& grid = isometricGrid.getGrid();
+
+    Board board(isometricGrid.getWidth(), isometricGrid.getHeight());
+    for (int row = 0; row < board.height; ++row) {
+        for (int col = 0; col < board.width; ++col) {
+            const int idx = board.index({ static_cast<int16_t>(row), static_cast<int16_t>(col) });
+            board.cells[idx] = grid[row][col].cellType;
+        }
+    }
+    return board;
+}
+
+}
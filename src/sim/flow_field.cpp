@@ -0,0 +1,64 @@
+#include "sim/flow_field.h"
+
+namespace Sim {
+
+void FlowField::compute(const Board& board, const std::vector<GridPos>& goals) {
+    width = board.getWidth();
+    height = board.getHeight();
+    dist.assign(board.getCellCount(), UNREACHABLE);
+    nextDir.assign(board.getCellCount(), -1);
+
+    // Every cell is queued at most once, reserved up front so the
+    // buckets never grow once the field has run on a board this size
+    buckets.resize(BUCKET_COUNT);
+    for (std::vector<int>& bucket : buckets) {
+        bucket.clear();
+        bucket.reserve(board.getCellCount());
+    }
+
+    size_t pending = 0;
+    for (const GridPos& goal : goals) {
+        if (!board.inBounds(goal)) {
+            continue;
+        }
+        const int idx = board.index(goal);
+        if (dist[idx] != 0) {
+            dist[idx] = 0;
+            buckets[0].push_back((goal.row << 16) | goal.col);
+            ++pending;
+        }
+    }
+
+    // Walk the buckets in distance order, stale entries are skipped.
+    // Entries are packed (row << 16 | col) to avoid dividing back from the index.
+    for (uint32_t d = 0; pending > 0; ++d) {
+        std::vector<int>& bucket = buckets[d & (BUCKET_COUNT - 1)];
+        for (size_t i = 0; i < bucket.size(); ++i) {
+            const int row = bucket[i] >> 16;
+            const int col = bucket[i] & 0xFFFF;
+            --pending;
+            if (dist[row * width + col] != d) {
+                continue;
+            }
+            for (int dir = 0; dir < 4; ++dir) {
+                const int nRow = row + NEIGHBOURS[dir].row;
+                const int nCol = col + NEIGHBOURS[dir].col;
+                if (nRow < 0 || nRow >= height || nCol < 0 || nCol >= width) {
+                    continue;
+                }
+                const int idx = nRow * width + nCol;
+                const int cost = stepCost(board.getCellType(idx));
+                if (cost == 0 || d + cost >= dist[idx]) {
+                    continue;
+                }
+                dist[idx] = static_cast<uint16_t>(d + cost);
+                nextDir[idx] = static_cast<int8_t>((dir + 2) % 4); // back towards current
+                buckets[(d + cost) & (BUCKET_COUNT - 1)].push_back((nRow << 16) | nCol);
+                ++pending;
+            }
+        }
+        bucket.clear();
+    }
+}
+
+}
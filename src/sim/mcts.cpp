@@ -0,0 +1,343 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include "sim/mcts.h"
+#include "sim/scenario.h"
+
+namespace Sim {
+
+namespace {
+
+    typedef std::chrono::steady_clock Clock;
+
+    const size_t MAX_MOVE_CANDIDATES = 4;
+
+    // Journal entries kept per thread, deep rollouts fit without growing it
+    const size_t RESERVED_JOURNAL_ENTRIES = 8192;
+
+    // Tree nodes live in the thread's arena: plain data, linked by pointers
+    struct Node {
+        Action action;        // action that led here
+        Node* parent = nullptr;
+        Node* firstChild = nullptr;
+        Node* nextSibling = nullptr;
+        Action* untried = nullptr; // legal actions not expanded yet
+        uint16_t untriedCount = 0;
+        bool expanded = false;     // untried list filled
+        int8_t team = NO_TEAM;     // team that played `action`
+        uint32_t visits = 0;
+        double reward = 0;         // summed, from `team`'s point of view
+    };
+
+    // Result of a rollout for `team`: 1 win, 0 loss, otherwise its share of the hp left
+    double evaluate(const Battle& battle, int team) {
+        if (battle.isOver()) {
+            const int winner = battle.winningTeam();
+            return winner == team ? 1.0 : (winner == NO_TEAM ? 0.5 : 0.0);
+        }
+        int own = 0, enemy = 0;
+        for (const Unit& unit : battle.getUnits()) {
+            (unit.team == team ? own : enemy) += unit.hp;
+        }
+        return (own + enemy) > 0 ? double(own) / (own + enemy) : 0.5;
+    }
+
+    // Actions worth searching from a state: every attack, ending the turn,
+    // the greedy move and a few random moves. Keeps the branching factor
+    // around 10 instead of one child per reachable cell.
+    void candidateActions(const Battle& battle, GreedyAi& greedy, Rng& rng,
+                          std::vector<Action>& legal, std::vector<Action>& out) {
+        out.clear();
+        const Action greedyChoice = greedy.choose(battle);
+        battle.legalActions(legal);
+
+        size_t moves = 0;
+        for (const Action& action : legal) {
+            if (action.type == MOVE) {
+                legal[moves++] = action; // compact the moves at the front
+            }
+            else {
+                out.push_back(action);
+            }
+        }
+        if (greedyChoice.type == MOVE) {
+            out.push_back(greedyChoice);
+        }
+        for (size_t i = 0; i < MAX_MOVE_CANDIDATES && moves > 0; ++i) {
+            const uint32_t pick = rng.range(static_cast<uint32_t>(moves));
+            if (legal[pick].target != greedyChoice.target || greedyChoice.type != MOVE) {
+                out.push_back(legal[pick]);
+            }
+            legal[pick] = legal[--moves];
+        }
+    }
+
+    bool sameAction(const Action& a, const Action& b) {
+        return a.type == b.type && (a.type == END_TURN || a.target == b.target);
+    }
+}
+
+// Search state of one thread, reused from one search to the next
+struct MctsAi::ThreadContext {
+    Arena arena;
+    Rng rng;
+    GreedyAi rolloutAi;
+    Battle battle; // copy of the root, rolled back to it after every iteration
+    std::vector<Action> scratch;
+    std::vector<Action> candidates;
+    std::vector<RootStat> stats;
+    uint64_t iterations = 0;
+};
+
+// One thread's search: fills its context's stats with the visits of each root action.
+void MctsAi::search(size_t t) {
+    ThreadContext& ctx = *contexts[t];
+    ctx.arena.reset();
+    ctx.rng.reseed(config.seed + generation * 0x9E3779B97F4A7C15ull + t);
+    ctx.iterations = 0;
+
+    Battle& battle = ctx.battle;
+    Rng& rng = ctx.rng;
+    const int rootTeam = root->activeUnit().team;
+
+    Node* rootNode = ctx.arena.create<Node>();
+
+    // New root: the greedy fields of the last search don't apply. Within
+    // the search they are kept, every iteration starts from this root and
+    // the policy already plays a whole round on one field.
+    ctx.rolloutAi.reset();
+
+    // One copy per search, iterations undo their changes through the journal
+    battle = *root;
+    battle.setJournaling(true);
+    battle.reserveJournal(RESERVED_JOURNAL_ENTRIES);
+    const size_t rootMark = battle.journalMark();
+
+    while (config.maxIterations == 0 || ctx.iterations < config.maxIterations) {
+        if ((ctx.iterations & 15) == 0 && Clock::now() >= deadline) {
+            break;
+        }
+        ++ctx.iterations;
+
+        // Fresh damage rolls for every iteration, so the search
+        // doesn't trust one particular sequence of luck
+        battle.rollback(rootMark);
+        battle.getRng().reseed(rng.next());
+        Node* node = rootNode;
+
+        // Selection: UCT down the tree while everything is expanded. The
+        // tree is open loop (fresh rolls every iteration): a child found
+        // illegal under this iteration's rolls (its target died, moved...)
+        // ends the descent, the rollout starts from its parent.
+        while (node->expanded && node->untriedCount == 0 && node->firstChild) {
+            const double logVisits = std::log(double(node->visits));
+            Node* best = nullptr;
+            double bestScore = -1;
+            for (Node* child = node->firstChild; child; child = child->nextSibling) {
+                const double score = child->reward / child->visits +
+                                     config.exploration * std::sqrt(logVisits / child->visits);
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = child;
+                }
+            }
+            if (!battle.apply(best->action)) {
+                break;
+            }
+            node = best;
+        }
+
+        // Expansion: one new child per iteration
+        if (!battle.isOver()) {
+            if (!node->expanded) {
+                candidateActions(battle, ctx.rolloutAi, rng, ctx.scratch, ctx.candidates);
+                node->untried = ctx.arena.allocateArray<Action>(ctx.candidates.size());
+                std::copy(ctx.candidates.begin(), ctx.candidates.end(), node->untried);
+                node->untriedCount = static_cast<uint16_t>(ctx.candidates.size());
+                node->expanded = true;
+            }
+            // Untried actions were listed under other rolls too, one that
+            // isn't legal now stays untried for a later iteration
+            if (node->untriedCount > 0) {
+                const uint32_t pick = rng.range(node->untriedCount);
+                const Action action = node->untried[pick];
+                const int8_t team = static_cast<int8_t>(battle.activeUnit().team);
+                if (battle.apply(action)) {
+                    Node* child = ctx.arena.create<Node>();
+                    child->action = action;
+                    child->team = team;
+                    child->parent = node;
+                    child->nextSibling = node->firstChild;
+                    node->firstChild = child;
+                    node->untried[pick] = node->untried[--node->untriedCount];
+                    node = child;
+                }
+            }
+        }
+
+        // Rollout: greedy with some random actions, for a few rounds
+        const uint32_t lastRound = battle.getTurn() + config.rolloutRounds;
+        while (!battle.isOver() && battle.getTurn() < lastRound) {
+            if (rng.range(10) == 0) {
+                battle.legalActions(ctx.scratch);
+                battle.apply(ctx.scratch[rng.range(static_cast<uint32_t>(ctx.scratch.size()))]);
+            }
+            else {
+                battle.apply(ctx.rolloutAi.choose(battle));
+            }
+        }
+
+        // Backpropagation
+        const double result = evaluate(battle, rootTeam);
+        for (; node; node = node->parent) {
+            ++node->visits;
+            node->reward += (node->team == rootTeam) ? result : 1.0 - result;
+        }
+    }
+
+    ctx.stats.clear();
+    for (Node* child = rootNode->firstChild; child; child = child->nextSibling) {
+        ctx.stats.push_back({child->action, child->visits});
+    }
+}
+
+MctsAi::MctsAi(MctsConfig config) : config(config) {
+    int threads = config.threads;
+    if (threads <= 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (int t = 0; t < threads; ++t) {
+        contexts.push_back(std::unique_ptr<ThreadContext>(new ThreadContext()));
+    }
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back(&MctsAi::workerLoop, this, t);
+    }
+}
+
+MctsAi::~MctsAi() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeWorkers.notify_all();
+    // A search in flight runs to its deadline first
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void MctsAi::workerLoop(size_t t) {
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeWorkers.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+
+        search(t);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--running == 0) {
+            workersDone.notify_one();
+        }
+    }
+}
+
+bool MctsAi::startSearch(const Battle& battle) {
+    if (searching) {
+        return false;
+    }
+    searching = true;
+    battle.legalActions(legal);
+    onlyChoice = legal.size() == 1;
+    if (onlyChoice) {
+        return true;
+    }
+
+    // Hand the job to the workers
+    rootBattle = battle;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        root = &rootBattle;
+        deadline = Clock::now() + std::chrono::milliseconds(config.timeBudgetMs);
+        running = workers.size();
+        ++generation;
+    }
+    wakeWorkers.notify_all();
+    return true;
+}
+
+bool MctsAi::pollResult(Action& out) {
+    if (!searching) {
+        return false;
+    }
+    if (!onlyChoice) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (running != 0) {
+            return false;
+        }
+    }
+    out = collectResult();
+    searching = false;
+    return true;
+}
+
+void MctsAi::discardSearch() {
+    if (!searching) {
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        workersDone.wait(lock, [&] { return running == 0; });
+    }
+    searching = false;
+}
+
+Action MctsAi::choose(const Battle& battle) {
+    startSearch(battle);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        workersDone.wait(lock, [&] { return running == 0; });
+    }
+    Action action;
+    pollResult(action);
+    return action;
+}
+
+Action MctsAi::collectResult() {
+    lastIterations = 0;
+    if (onlyChoice) {
+        return legal[0];
+    }
+
+    total.clear();
+    for (const std::unique_ptr<ThreadContext>& ctx : contexts) {
+        lastIterations += ctx->iterations;
+        for (const RootStat& stat : ctx->stats) {
+            auto it = std::find_if(total.begin(), total.end(),
+                                   [&](const RootStat& s) { return sameAction(s.action, stat.action); });
+            if (it == total.end()) {
+                total.push_back(stat);
+            }
+            else {
+                it->visits += stat.visits;
+            }
+        }
+    }
+
+    const RootStat* best = nullptr;
+    for (const RootStat& stat : total) {
+        if (!best || stat.visits > best->visits) {
+            best = &stat;
+        }
+    }
+    return best ? best->action : legal[0];
+}
+
+}
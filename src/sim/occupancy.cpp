@@ -0,0 +1,43 @@
+#include "sim/occupancy.h"
+
+namespace Sim {
+
+void Occupancy::reset(const Board& b) {
+    width = b.getWidth();
+    height = b.getHeight();
+    cellToUnit.assign(b.getCellCount(), NO_UNIT);
+    unitToCell.clear();
+}
+
+bool Occupancy::place(UnitId id, GridPos p) {
+    if (p.row < 0 || p.row >= height || p.col < 0 || p.col >= width) {
+        return false;
+    }
+    const int idx = p.row * width + p.col;
+    if (cellToUnit[idx] != NO_UNIT && cellToUnit[idx] != id) {
+        return false;
+    }
+
+    if (id >= unitToCell.size()) {
+        unitToCell.resize(id + 1, -1);
+    }
+    if (unitToCell[id] != -1) {
+        cellToUnit[unitToCell[id]] = NO_UNIT;
+    }
+    cellToUnit[idx] = id;
+    unitToCell[id] = idx;
+    return true;
+}
+
+bool Occupancy::move(UnitId id, GridPos to) {
+    return place(id, to);
+}
+
+void Occupancy::remove(UnitId id) {
+    if (id < unitToCell.size() && unitToCell[id] != -1) {
+        cellToUnit[unitToCell[id]] = NO_UNIT;
+        unitToCell[id] = -1;
+    }
+}
+
+}
@@ -0,0 +1,191 @@
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include "sim/replay.h"
+
+namespace Sim {
+
+static const char REPLAY_MAGIC[4] = {'S', 'B', 'R', 'P'};
+static const uint64_t REPLAY_VERSION = 3; // 2: battle state stores the turn order size, 3: no source indices
+
+// -- ActionLog
+void ActionLog::append(const Action& action) {
+    ByteWriter writer(bytes);
+    const uint64_t cell = (action.type == END_TURN) ? 0 : uint64_t(action.target.row) * boardWidth + action.target.col;
+    writer.writeVarint((cell << 2) | action.type);
+    ++count;
+}
+
+Action ActionLog::decode(ByteReader& in, int boardWidth) {
+    const uint64_t v = in.readVarint();
+    const uint64_t cell = v >> 2;
+    Action action;
+    action.type = static_cast<ActionType>(v & 0x3);
+    action.target = { static_cast<int16_t>(cell / boardWidth), static_cast<int16_t>(cell % boardWidth) };
+    return action;
+}
+
+// -- BattleRecorder
+BattleRecorder::BattleRecorder(const Battle& battle)
+    : initial(battle), log(battle.getBoard().getWidth()) {
+    snapshots.reserve(RESERVED_SNAPSHOTS);
+    snapshotBytes.reserve(RESERVED_SNAPSHOT_BYTES);
+}
+
+bool BattleRecorder::apply(Battle& battle, const Action& action) {
+    const uint32_t turnBefore = battle.getTurn();
+    if (!battle.apply(action)) {
+        return false;
+    }
+    log.append(action);
+
+    // New round: snapshot if the last one is far enough behind
+    const uint32_t lastSnapshotTurn = snapshots.empty() ? initial.getTurn() : snapshots.back().turn;
+    if (battle.getTurn() != turnBefore && battle.getTurn() >= lastSnapshotTurn + SNAPSHOT_INTERVAL) {
+        Snapshot snapshot;
+        snapshot.turn = battle.getTurn();
+        snapshot.step = log.getCount();
+        snapshot.logOffset = log.getByteCount();
+        snapshot.stateOffset = snapshotBytes.size();
+        battle.saveState(snapshotBytes);
+        snapshot.stateSize = snapshotBytes.size() - snapshot.stateOffset;
+        snapshots.push_back(snapshot);
+    }
+    return true;
+}
+
+int BattleRecorder::restoreBefore(Battle& battle, uint32_t turn, size_t step) const {
+    battle = initial;
+    int used = -1;
+    for (int i = static_cast<int>(snapshots.size()) - 1; i >= 0; --i) {
+        if (snapshots[i].turn <= turn && snapshots[i].step <= step) {
+            ByteReader in(snapshotBytes.data() + snapshots[i].stateOffset, snapshots[i].stateSize);
+            if (battle.loadState(in)) {
+                used = i;
+            }
+            else {
+                battle = initial;
+            }
+            break;
+        }
+    }
+    return used;
+}
+
+Battle BattleRecorder::seekTurn(uint32_t turn) const {
+    Battle battle;
+    const int used = restoreBefore(battle, turn, log.getCount());
+    size_t step = (used < 0) ? 0 : snapshots[used].step;
+
+    ByteReader in(log.getBytes());
+    in.seek((used < 0) ? 0 : snapshots[used].logOffset);
+    const int width = battle.getBoard().getWidth();
+    while (battle.getTurn() < turn && step < log.getCount()) {
+        battle.apply(ActionLog::decode(in, width));
+        ++step;
+    }
+    return battle;
+}
+
+Battle BattleRecorder::seekStep(size_t step) const {
+    Battle battle;
+    const int used = restoreBefore(battle, UINT32_MAX, step);
+    size_t current = (used < 0) ? 0 : snapshots[used].step;
+
+    ByteReader in(log.getBytes());
+    in.seek((used < 0) ? 0 : snapshots[used].logOffset);
+    const int width = battle.getBoard().getWidth();
+    while (current < step && current < log.getCount()) {
+        battle.apply(ActionLog::decode(in, width));
+        ++current;
+    }
+    return battle;
+}
+
+bool BattleRecorder::saveToFile(const std::string filename) const {
+    std::vector<uint8_t> bytes(REPLAY_MAGIC, REPLAY_MAGIC + 4);
+    ByteWriter writer(bytes);
+    writer.writeVarint(REPLAY_VERSION);
+
+    // Board size (cell types are part of the state below)
+    const Board& board = initial.getBoard();
+    writer.writeVarint(board.getWidth());
+    writer.writeVarint(board.getHeight());
+
+    std::vector<uint8_t> state;
+    initial.saveState(state);
+    writer.writeVarint(state.size());
+    bytes.insert(bytes.end(), state.begin(), state.end());
+
+    writer.writeVarint(log.getCount());
+    writer.writeVarint(log.getByteCount());
+    bytes.insert(bytes.end(), log.getBytes().begin(), log.getBytes().end());
+
+    try {
+        std::filesystem::create_directories(replaysFolder);
+        std::ofstream file(replaysFolder + filename, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        return file.good();
+    }
+    catch (const std::exception& e) {
+        return false;
+    }
+}
+
+bool BattleRecorder::loadFromFile(const std::string filename) {
+    std::ifstream file(replaysFolder + filename, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (bytes.size() < 4 || !std::equal(REPLAY_MAGIC, REPLAY_MAGIC + 4, bytes.begin())) {
+        return false;
+    }
+
+    ByteReader in(bytes.data() + 4, bytes.size() - 4);
+    if (in.readVarint() != REPLAY_VERSION) {
+        return false;
+    }
+
+    const int width = static_cast<int>(in.readVarint());
+    const int height = static_cast<int>(in.readVarint());
+    // Positions are int16, and no real map gets close to a million cells
+    if (!in.ok() || width <= 0 || height <= 0 || width > INT16_MAX || height > INT16_MAX ||
+        width * height > (1 << 20)) {
+        return false;
+    }
+    Battle battle(Board(width, height), 0);
+    const size_t stateSize = in.readVarint();
+    const size_t stateStart = in.getOffset();
+    if (!in.ok() || !battle.loadState(in) || in.getOffset() != stateStart + stateSize) {
+        return false;
+    }
+
+    const size_t actionCount = in.readVarint();
+    const size_t logSize = in.readVarint();
+    if (!in.ok()) {
+        return false;
+    }
+
+    // Replay everything once, rebuilds the snapshots and checks the log
+    BattleRecorder loaded(battle);
+    for (size_t i = 0; i < actionCount; ++i) {
+        const Action action = ActionLog::decode(in, width);
+        if (!in.ok() || !loaded.apply(battle, action)) {
+            return false;
+        }
+    }
+    if (loaded.log.getByteCount() != logSize) {
+        return false;
+    }
+
+    *this = std::move(loaded);
+    return true;
+}
+
+}
@@ -0,0 +1,125 @@
+#include <climits>
+
+#include "sim/scenario.h"
+
+namespace Sim {
+
+static Unit makeSoldier(uint8_t team, GridPos pos) {
+    Unit unit;
+    unit.team = team;
+    unit.pos = pos;
+    unit.hp = unit.maxHp = 50;
+    unit.attack = 12;
+    unit.range = 1;
+    unit.initiative = 10;
+    return unit;
+}
+
+void setupSkirmish(Battle& battle, int unitsPerTeam) {
+    const Board& board = battle.getBoard();
+
+    for (uint8_t team = 0; team < 2; ++team) {
+        // Candidate cells for this team
+        std::vector<GridPos> spawns;
+        for (int idx = 0; idx < board.getCellCount(); ++idx) {
+            const GridPos p = board.position(idx);
+            if (inSpawnZone(board, team, p) && board.isWalkable(p)) {
+                spawns.push_back(p);
+            }
+        }
+
+        for (int i = 0; i < unitsPerTeam && !spawns.empty(); ++i) {
+            // Pick one and swap remove it so cells aren't reused
+            const uint32_t pick = battle.getRng().range(static_cast<uint32_t>(spawns.size()));
+            battle.addUnit(makeSoldier(team, spawns[pick]));
+            spawns[pick] = spawns.back();
+            spawns.pop_back();
+        }
+    }
+}
+
+const FlowField& GreedyAi::fieldFor(const Battle& battle, int team) {
+    const int slot = team == 0 ? 0 : 1;
+    const uint32_t round = battle.getTurn() % FIELD_ROUNDS;
+    if (fieldValid[slot][round] && fieldTurns[slot][round] == battle.getTurn()) {
+        return fields[slot][round];
+    }
+
+    // Once per round and per team, towards every enemy
+    goals.clear();
+    for (const Unit& unit : battle.getUnits()) {
+        if (unit.isAlive() && unit.team != team) {
+            goals.push_back(unit.pos);
+        }
+    }
+    FlowField& field = fields[slot][round];
+    field.compute(battle.getBoard(), goals);
+    fieldTurns[slot][round] = battle.getTurn();
+    fieldValid[slot][round] = true;
+    return field;
+}
+
+Action GreedyAi::choose(const Battle& battle) {
+    if (!battle.hasActiveUnit()) {
+        return Action::endTurn();
+    }
+    battle.legalActions(scratch);
+    const Unit& self = battle.activeUnit();
+
+    // Attack the weakest enemy in range
+    const Action* best = nullptr;
+    int bestHp = INT_MAX;
+    for (const Action& action : scratch) {
+        if (action.type == ATTACK) {
+            const int hp = battle.getUnit(battle.unitAt(action.target)).hp;
+            if (hp < bestHp) {
+                bestHp = hp;
+                best = &action;
+            }
+        }
+    }
+    if (best) {
+        return *best;
+    }
+    if (self.movePoints <= 0) {
+        return Action::endTurn();
+    }
+
+    // Follow the field while the next cell is free, until in range
+    const FlowField& field = fieldFor(battle, self.team);
+    GridPos pos = self.pos;
+    GridPos next;
+    int steps = 0;
+    while (steps < self.movePoints && field.distanceAt(pos) > self.range &&
+           field.nextStep(pos, next) && !battle.getOccupancy().isOccupied(next)) {
+        pos = next;
+        ++steps;
+    }
+    if (steps > 0) {
+        return Action::move(pos);
+    }
+
+    // Path blocked by a unit: best reachable cell on the field instead
+    uint16_t bestDistance = field.distanceAt(self.pos);
+    for (const Action& action : scratch) {
+        if (action.type == MOVE && field.distanceAt(action.target) < bestDistance) {
+            bestDistance = field.distanceAt(action.target);
+            best = &action;
+        }
+    }
+    if (best) {
+        return *best;
+    }
+
+    return Action::endTurn();
+}
+
+int playOut(Battle& battle) {
+    GreedyAi ai;
+    while (!battle.isOver() && battle.getTurn() < MAX_TURNS) {
+        battle.apply(ai.choose(battle));
+    }
+    return battle.winningTeam();
+}
+
+}
@@ -0,0 +1,183 @@
+#include <cstdlib>
+
+#include "sim/vision.h"
+
+namespace Sim {
+
+// Octant transforms for the shadowcasting
+static const int OCTANTS[8][4] = {
+    { 1,  0,  0,  1}, { 0,  1,  1,  0}, { 0, -1,  1,  0}, {-1,  0,  0,  1},
+    {-1,  0,  0, -1}, { 0, -1, -1,  0}, { 0,  1, -1,  0}, { 1,  0,  0, -1},
+};
+
+Vision::Vision(const Board& board, int sightRadius)
+    : width(board.getWidth()), height(board.getHeight()), sightRadius(sightRadius),
+      opaque((board.getCellCount() + 63) / 64, 0), opaqueNow(opaque.size(), 0),
+      castStamp(board.getCellCount(), 0) {
+    for (int idx = 0; idx < board.getCellCount(); ++idx) {
+        if (board.blocksSight(board.position(idx))) {
+            opaque[idx >> 6] |= uint64_t(1) << (idx & 63);
+        }
+    }
+}
+
+void Vision::ensureTeam(int team) {
+    while (static_cast<int>(seenBy.size()) <= team) {
+        seenBy.emplace_back(width * height, 0);
+        visible.emplace_back((width * height + 63) / 64, 0);
+    }
+}
+
+void Vision::addSight(int team, const std::vector<int>& cells) {
+    std::vector<uint16_t>& counts = seenBy[team];
+    for (int idx : cells) {
+        if (counts[idx]++ == 0) {
+            visible[team][idx >> 6] |= uint64_t(1) << (idx & 63);
+        }
+    }
+    ++revision;
+}
+
+void Vision::removeSight(int team, const std::vector<int>& cells) {
+    std::vector<uint16_t>& counts = seenBy[team];
+    for (int idx : cells) {
+        if (--counts[idx] == 0) {
+            visible[team][idx >> 6] &= ~(uint64_t(1) << (idx & 63));
+        }
+    }
+    ++revision;
+}
+
+void Vision::detectCellChanges(const Board& board) {
+    std::fill(opaqueNow.begin(), opaqueNow.end(), 0);
+    for (int idx = 0; idx < board.getCellCount(); ++idx) {
+        if (board.blocksSight(board.position(idx))) {
+            opaqueNow[idx >> 6] |= uint64_t(1) << (idx & 63);
+        }
+    }
+    // Word by word, nothing to do for the (usual) words that match
+    for (size_t word = 0; word < opaque.size(); ++word) {
+        for (uint64_t diff = opaque[word] ^ opaqueNow[word]; diff != 0; diff &= diff - 1) {
+            int bit = 0;
+            while (!((diff >> bit) & 1)) {
+                ++bit;
+            }
+            const int idx = static_cast<int>(word * 64) + bit;
+            cellChanged({ static_cast<int16_t>(idx / width), static_cast<int16_t>(idx % width) });
+        }
+    }
+    opaque.swap(opaqueNow);
+}
+
+void Vision::update(const Battle& battle) {
+    const Board& board = battle.getBoard();
+    const std::vector<Unit>& units = battle.getUnits();
+    detectCellChanges(board);
+    if (sights.size() < units.size()) {
+        sights.resize(units.size());
+    }
+
+    for (const Unit& unit : units) {
+        UnitSight& sight = sights[unit.id];
+        ensureTeam(unit.team);
+
+        const int origin = unit.isAlive() ? board.index(unit.pos) : -1;
+        if (origin == sight.origin && !sight.dirty) {
+            continue;
+        }
+
+        if (sight.origin != -1) {
+            removeSight(unit.team, sight.cells);
+            sight.cells.clear();
+        }
+        sight.origin = origin;
+        sight.dirty = false;
+        if (origin != -1) {
+            cast(board, unit.pos, sight.cells);
+            addSight(unit.team, sight.cells);
+        }
+    }
+}
+
+void Vision::cellChanged(GridPos p) {
+    for (UnitSight& sight : sights) {
+        if (sight.origin == -1) {
+            continue;
+        }
+        const GridPos origin = { static_cast<int16_t>(sight.origin / width), static_cast<int16_t>(sight.origin % width) };
+        if (distance(origin, p) <= sightRadius) {
+            sight.dirty = true;
+        }
+    }
+}
+
+void Vision::cast(const Board& board, GridPos origin, std::vector<int>& out) {
+    if (++castGeneration == 0) {
+        std::fill(castStamp.begin(), castStamp.end(), 0);
+        castGeneration = 1;
+    }
+
+    const int start = board.index(origin);
+    castStamp[start] = castGeneration;
+    out.push_back(start);
+
+    for (const int* o : OCTANTS) {
+        castOctant(board, origin, 1, 1.0, 0.0, o[0], o[1], o[2], o[3], out);
+    }
+}
+
+// Recursive shadowcasting (Bjorn Bergstrom) for one octant. Scans rows
+// outwards, keeping the [start, end] slope window that is still lit.
+void Vision::castOctant(const Board& board, GridPos origin, int row, double start, double end,
+                        int xx, int xy, int yx, int yy, std::vector<int>& out) {
+    if (start < end) {
+        return;
+    }
+
+    double newStart = 0.0;
+    for (int j = row; j <= sightRadius; ++j) {
+        bool blocked = false;
+        for (int dx = -j, dy = -j; dx <= 0; ++dx) {
+            const double leftSlope = (dx - 0.5) / (dy + 0.5);
+            const double rightSlope = (dx + 0.5) / (dy - 0.5);
+            if (start < rightSlope) {
+                continue;
+            }
+            if (end > leftSlope) {
+                break;
+            }
+
+            const GridPos p = { static_cast<int16_t>(origin.row + dx * yx + dy * yy),
+                                static_cast<int16_t>(origin.col + dx * xx + dy * xy) };
+
+            // Light it if it's within the grid distance
+            if (board.inBounds(p) && std::abs(dx) + std::abs(dy) <= sightRadius) {
+                const int idx = board.index(p);
+                if (castStamp[idx] != castGeneration) {
+                    castStamp[idx] = castGeneration;
+                    out.push_back(idx);
+                }
+            }
+
+            const bool opaque = board.blocksSight(p);
+            if (blocked) {
+                if (opaque) {
+                    newStart = rightSlope;
+                    continue;
+                }
+                blocked = false;
+                start = newStart;
+            }
+            else if (opaque && j < sightRadius) {
+                blocked = true;
+                castOctant(board, origin, j + 1, start, leftSlope, xx, xy, yx, yy, out);
+                newStart = rightSlope;
+            }
+        }
+        if (blocked) {
+            break;
+        }
+    }
+}
+
+}
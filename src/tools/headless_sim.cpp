@@ -0,0 +1,89 @@
+// Headless battle runner: plays battles with the SDL free simulation as fast
+// as the CPU allows, for balancing and AI work.
+// usage: ./bin/headless_sim [map file] [battle count] [seed] [team 1 ai: greedy|mcts] [mcts ms]
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "map_files.h"
+#include "sim/battle.h"
+#include "sim/mcts.h"
+#include "sim/scenario.h"
+
+int main(int argc, char *args[])
+{
+    const std::string mapFile = argc > 1 ? args[1] : "test_map.json";
+    const int battleCount = argc > 2 ? std::stoi(args[2]) : 1000;
+    const uint64_t seed = argc > 3 ? std::stoull(args[3]) : 1;
+    const bool useMcts = argc > 4 && std::string(args[4]) == "mcts";
+
+    // Only when asked for, the search starts a thread per core
+    std::unique_ptr<Sim::MctsAi> mcts;
+    if (useMcts) {
+        Sim::MctsConfig mctsConfig;
+        mctsConfig.timeBudgetMs = argc > 5 ? std::stoi(args[5]) : 10;
+        mctsConfig.seed = seed;
+        mcts.reset(new Sim::MctsAi(mctsConfig));
+    }
+    uint64_t mctsIterations = 0;
+    uint64_t mctsDecisions = 0;
+
+    IsometricGrid isometricGrid;
+    if (!MapFiles::loadGrid(isometricGrid, mapFile)) {
+        std::cerr << "Could not load map " << mapFile << std::endl;
+        return 1;
+    }
+    const Sim::Board board = Sim::Board::fromIsometricGrid(isometricGrid);
+
+    int wins[2] = {0, 0};
+    int draws = 0;
+    uint64_t rounds = 0;
+
+    const auto startTime = std::chrono::steady_clock::now();
+    for (int i = 0; i < battleCount; ++i) {
+        Sim::Battle battle(board, seed + i);
+        Sim::setupSkirmish(battle, 4);
+        battle.start();
+
+        int winner;
+        if (useMcts) {
+            // Team 0 greedy, team 1 searches
+            Sim::GreedyAi greedy;
+            while (!battle.isOver() && battle.getTurn() < Sim::MAX_TURNS) {
+                if (battle.activeUnit().team == 1) {
+                    battle.apply(mcts->choose(battle));
+                    mctsIterations += mcts->getLastIterations();
+                    ++mctsDecisions;
+                }
+                else {
+                    battle.apply(greedy.choose(battle));
+                }
+            }
+            winner = battle.winningTeam();
+        }
+        else {
+            winner = Sim::playOut(battle);
+        }
+        if (winner == Sim::NO_TEAM) {
+            ++draws;
+        }
+        else {
+            ++wins[winner];
+        }
+        rounds += battle.getTurn();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    std::cout << "---- headless" << std::endl;
+    std::cout << "battles : " << battleCount << " in " << seconds << "s ("
+              << battleCount / seconds << " battles/s)" << std::endl;
+    std::cout << "team 0 wins : " << wins[0] << std::endl;
+    std::cout << "team 1 wins : " << wins[1] << std::endl;
+    std::cout << "draws : " << draws << std::endl;
+    std::cout << "average rounds : " << double(rounds) / battleCount << std::endl;
+    if (mctsDecisions > 0) {
+        std::cout << "mcts iterations per decision : " << mctsIterations / mctsDecisions << std::endl;
+    }
+    return 0;
+}
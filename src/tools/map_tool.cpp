@@ -0,0 +1,309 @@
+// Map pack checker: loads every map of a folder in parallel, validates it
+// (dimensions, walkable regions, spawn zones) and converts the JSON maps
+// that pass to the runtime format (a .map next to each).
+// usage: ./bin/map_tool [maps folder] [--no-convert] [--units N] [--threads N]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "map_files.h"
+#include "sim/board.h"
+#include "sim/flow_field.h"
+#include "sim/scenario.h"
+
+namespace {
+
+const int DEFAULT_UNITS_PER_TEAM = 4; // what the game's skirmish places
+
+struct MapReport {
+    std::string name;
+    std::vector<std::string> errors;
+    std::vector<std::string> warnings;
+    int walkable = 0;
+    int regions = 0;
+    size_t convertedBytes = 0; // 0 = not converted
+};
+
+// Per thread, reused from one map to the next
+struct WorkerState {
+    IsometricGrid grid;
+    Sim::FlowField field;
+    std::vector<Sim::GridPos> goals;
+    std::vector<uint8_t> bytes;
+    std::vector<uint8_t> seen;
+};
+
+// "rows" / "cols" against what the document actually holds
+void checkJsonDimensions(const json& j, const IsometricGrid& grid, MapReport& report) {
+    if (!j.contains("rows") || !j.contains("cols") || !j.contains("cells") || !j["cells"].is_array()) {
+        report.errors.push_back("missing rows / cols / cells");
+        return;
+    }
+    const int rows = j["rows"];
+    const int cols = j["cols"];
+    const json& cells = j["cells"];
+    if (rows <= 0 || cols <= 0) {
+        report.errors.push_back("empty map (" + std::to_string(rows) + "x" + std::to_string(cols) + ")");
+        return;
+    }
+    if (static_cast<int>(cells.size()) != rows) {
+        report.errors.push_back("rows is " + std::to_string(rows) + " but there are " +
+                                std::to_string(cells.size()) + " rows of cells");
+    }
+
+    const bool legacy = !j.contains("version");
+    for (size_t row = 0; row < cells.size(); ++row) {
+        const size_t length = legacy ? cells[row].size() : cells[row].get<std::string>().size();
+        if (static_cast<int>(length) != cols) {
+            report.errors.push_back("row " + std::to_string(row) + " has " + std::to_string(length) +
+                                    " cells, cols is " + std::to_string(cols));
+            break; // one is enough to know the file is off
+        }
+    }
+    if (legacy && !(j.value("cellWidth", 0.0f) > 0 && j.value("cellHeight", 0.0f) > 0)) {
+        report.errors.push_back("legacy map without a cell size");
+    }
+    if (!legacy && (rows > grid.getHeight() || cols > grid.getWidth())) {
+        report.warnings.push_back("bigger than the " + std::to_string(grid.getHeight()) + "x" +
+                                  std::to_string(grid.getWidth()) + " grid, outside cells are cut");
+    }
+}
+
+// Fill state.grid from the file, false (with errors in the report) if that didn't work
+bool loadMap(const std::filesystem::path& path, WorkerState& state, MapReport& report) {
+    int dropped = 0;
+    try {
+        if (MapFiles::isBinary(path.string())) {
+            if (!MapFiles::readFile(path.string(), state.bytes)) {
+                report.errors.push_back("can't read the file");
+                return false;
+            }
+            if (!MapFiles::decodeBinary(state.grid, state.bytes, &dropped)) {
+                report.errors.push_back("not a map file, or truncated");
+                return false;
+            }
+        }
+        else {
+            std::ifstream file(path);
+            if (!file.is_open()) {
+                report.errors.push_back("can't read the file");
+                return false;
+            }
+            json j;
+            file >> j;
+            checkJsonDimensions(j, state.grid, report);
+            if (!report.errors.empty()) {
+                return false;
+            }
+            if (!JsonUtils::gridFromJson(state.grid, j, &dropped)) {
+                report.errors.push_back("map format " + j["version"].dump() + " is newer than this build");
+                return false;
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        report.errors.push_back(std::string("can't parse: ") + e.what());
+        return false;
+    }
+
+    if (dropped > 0) {
+        report.errors.push_back(std::to_string(dropped) + " cells don't fit the grid");
+    }
+    return true;
+}
+
+// Walkable regions and spawn zones, with the game's own board and flow field
+void checkBoard(const Sim::Board& board, int unitsPerTeam, WorkerState& state, MapReport& report) {
+    const int cellCount = board.getCellCount();
+
+    // Regions: flood from every walkable cell no earlier flood reached
+    state.seen.assign(cellCount, 0);
+    int largest = 0;
+    for (int idx = 0; idx < cellCount; ++idx) {
+        const Sim::GridPos start = board.position(idx);
+        if (!board.isWalkable(start) || state.seen[idx]) {
+            continue;
+        }
+        ++report.regions;
+        state.goals.assign(1, start);
+        state.field.compute(board, state.goals);
+        int size = 0;
+        for (int k = 0; k < cellCount; ++k) {
+            if (state.field.distanceAt(board.position(k)) != Sim::UNREACHABLE) {
+                state.seen[k] = 1;
+                ++size;
+            }
+        }
+        report.walkable += size;
+        largest = std::max(largest, size);
+    }
+
+    if (report.walkable == 0) {
+        report.errors.push_back("no walkable cell");
+        return;
+    }
+    if (report.regions > 1) {
+        report.warnings.push_back("walkable cells are split in " + std::to_string(report.regions) +
+                                  " regions (largest " + std::to_string(largest) + " of " +
+                                  std::to_string(report.walkable) + " cells)");
+    }
+
+    // Spawns: enough cells in each zone and every one of them can walk
+    // to the other team's zone
+    for (int team = 0; team < 2; ++team) {
+        state.goals.clear();
+        for (int idx = 0; idx < cellCount; ++idx) {
+            const Sim::GridPos p = board.position(idx);
+            if (Sim::inSpawnZone(board, 1 - team, p) && board.isWalkable(p)) {
+                state.goals.push_back(p);
+            }
+        }
+        state.field.compute(board, state.goals);
+
+        int spawns = 0;
+        int stranded = 0;
+        for (int idx = 0; idx < cellCount; ++idx) {
+            const Sim::GridPos p = board.position(idx);
+            if (Sim::inSpawnZone(board, team, p) && board.isWalkable(p)) {
+                ++spawns;
+                stranded += (state.field.distanceAt(p) == Sim::UNREACHABLE);
+            }
+        }
+        const std::string zone = "team " + std::to_string(team) + " spawn zone";
+        if (spawns < unitsPerTeam) {
+            report.errors.push_back(zone + " has " + std::to_string(spawns) + " walkable cells, " +
+                                    std::to_string(unitsPerTeam) + " units need one each");
+        }
+        // An empty zone is already reported as such, not worth every cell of the other
+        if (stranded > 0 && !state.goals.empty()) {
+            report.errors.push_back(zone + ": " + std::to_string(stranded) +
+                                    " cells can't reach team " + std::to_string(1 - team) + "'s zone");
+        }
+    }
+}
+
+void processMap(const std::filesystem::path& path, bool convert, int unitsPerTeam,
+                WorkerState& state, MapReport& report) {
+    report.name = path.filename().string();
+    if (!loadMap(path, state, report)) {
+        return;
+    }
+    checkBoard(Sim::Board::fromIsometricGrid(state.grid), unitsPerTeam, state, report);
+
+    if (convert && report.errors.empty() && !MapFiles::isBinary(path.string())) {
+        std::filesystem::path target = path;
+        target.replace_extension(MapFiles::binaryExtension);
+        MapFiles::encodeBinary(state.grid, state.bytes);
+        if (MapFiles::writeFile(target.string(), state.bytes)) {
+            report.convertedBytes = state.bytes.size();
+        }
+        else {
+            report.errors.push_back("can't write " + target.string());
+        }
+    }
+}
+
+}
+
+int main(int argc, char *args[])
+{
+    std::string folder = JsonUtils::mapsFolder;
+    bool convert = true;
+    int unitsPerTeam = DEFAULT_UNITS_PER_TEAM;
+    int threadCount = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = args[i];
+            if (arg == "--no-convert") {
+                convert = false;
+            }
+            else if (arg == "--units" && i + 1 < argc) {
+                unitsPerTeam = std::stoi(args[++i]);
+            }
+            else if (arg == "--threads" && i + 1 < argc) {
+                threadCount = std::max(1, std::stoi(args[++i]));
+            }
+            else {
+                folder = arg;
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        // std::stoi on a value that isn't a number or doesn't fit an int
+        std::cerr << "usage: " << args[0] << " [maps folder] [--no-convert] [--units N] [--threads N]" << std::endl;
+        return 1;
+    }
+
+    // Every map of the folder, sorted so the report doesn't depend on the file system
+    std::vector<std::filesystem::path> paths;
+    try {
+        for (const auto& entry : std::filesystem::directory_iterator(folder)) {
+            const std::filesystem::path& path = entry.path();
+            if (entry.is_regular_file() &&
+                (path.extension() == ".json" || path.extension() == MapFiles::binaryExtension)) {
+                paths.push_back(path);
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Could not list " << folder << ": " << e.what() << std::endl;
+        return 1;
+    }
+    std::sort(paths.begin(), paths.end());
+
+    const auto startTime = std::chrono::steady_clock::now();
+
+    // Maps are handed out one at a time, big maps don't hold a whole share back
+    std::vector<MapReport> reports(paths.size());
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        WorkerState state;
+        for (size_t i = next++; i < paths.size(); i = next++) {
+            processMap(paths[i], convert, unitsPerTeam, state, reports[i]);
+        }
+    };
+    threadCount = std::min<int>(threadCount, std::max<size_t>(1, paths.size()));
+    std::vector<std::thread> threads;
+    for (int t = 1; t < threadCount; ++t) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    int failed = 0;
+    int warned = 0;
+    for (const MapReport& report : reports) {
+        failed += !report.errors.empty();
+        warned += !report.warnings.empty();
+        std::cout << report.name << ": " << (report.errors.empty() ? "ok" : "FAILED");
+        if (report.errors.empty()) {
+            std::cout << ", " << report.walkable << " walkable cells";
+            if (report.convertedBytes > 0) {
+                std::cout << ", converted (" << report.convertedBytes << " bytes)";
+            }
+        }
+        std::cout << std::endl;
+        for (const std::string& error : report.errors) {
+            std::cout << "    error: " << error << std::endl;
+        }
+        for (const std::string& warning : report.warnings) {
+            std::cout << "    warning: " << warning << std::endl;
+        }
+    }
+
+    std::cout << "----" << std::endl;
+    std::cout << "maps : " << reports.size() << " (" << failed << " failed, " << warned << " with warnings)" << std::endl;
+    std::cout << "threads : " << threadCount << std::endl;
+    std::cout << "time : " << seconds * 1000.0 << " ms" << std::endl;
+
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,107 @@
+#include "input.h"
+
+// Only the modifiers bindings care about, left and right count the same
+static Uint16 normalizeMods(Uint16 mod) {
+    Uint16 result = 0;
+    if (mod & KMOD_CTRL) {
+        result |= KMOD_CTRL;
+    }
+    if (mod & KMOD_SHIFT) {
+        result |= KMOD_SHIFT;
+    }
+    if (mod & KMOD_ALT) {
+        result |= KMOD_ALT;
+    }
+    return result;
+}
+
+Input::Input() {
+    bind(SDL_QUIT, 0, 0, QUIT_GAME);
+    bind(SDL_MOUSEMOTION, 0, 0, POINTER_MOVED);
+    bind(SDL_KEYDOWN, SDLK_F11, 0, TOGGLE_FULLSCREEN);
+
+    // Map editor
+    bind(SDL_KEYDOWN, SDLK_e, 0, TOGGLE_EDITOR);
+    bind(SDL_KEYDOWN, SDLK_1, 0, BRUSH_WALKABLE);
+    bind(SDL_KEYDOWN, SDLK_2, 0, BRUSH_OBSTACLE);
+    bind(SDL_KEYDOWN, SDLK_3, 0, BRUSH_EMPTY);
+    bind(SDL_KEYDOWN, SDLK_z, KMOD_CTRL, UNDO_EDIT);
+    bind(SDL_KEYDOWN, SDLK_z, KMOD_CTRL | KMOD_SHIFT, REDO_EDIT);
+    bind(SDL_KEYDOWN, SDLK_y, KMOD_CTRL, REDO_EDIT);
+    bind(SDL_KEYDOWN, SDLK_s, KMOD_CTRL, SAVE_MAP);
+    bind(SDL_MOUSEBUTTONDOWN, SDL_BUTTON_LEFT, 0, PAINT_PRESS);
+    bind(SDL_MOUSEBUTTONUP, SDL_BUTTON_LEFT, 0, PAINT_RELEASE);
+}
+
+void Input::bind(Uint32 eventType, SDL_Keycode code, Uint16 mods, Command command) {
+    bindings.push_back({ eventType, code, normalizeMods(mods), command });
+}
+
+Command Input::lookup(Uint32 eventType, SDL_Keycode code, Uint16 mods) const {
+    for (const Binding& binding : bindings) {
+        if (binding.eventType == eventType && binding.code == code && binding.mods == mods) {
+            return binding.command;
+        }
+    }
+    return NO_COMMAND;
+}
+
+void Input::push(InputFrame& frame, Command command, int x, int y, bool merge) const {
+    if (command == NO_COMMAND) {
+        return; // unbound
+    }
+    // A motion right after another one replaces it, only where the
+    // pointer ended up matters. Anything in between (a click) keeps both.
+    if (merge && frame.count > 0 && frame.commands[frame.count - 1].command == command) {
+        frame.commands[frame.count - 1].x = x;
+        frame.commands[frame.count - 1].y = y;
+        return;
+    }
+    frame.commands[frame.count++] = { command, x, y };
+}
+
+InputFrame Input::poll(Arena& frameArena, int waitMs) {
+    InputFrame frame;
+    frame.commands = frameArena.allocateArray<CommandEvent>(MAX_FRAME_COMMANDS);
+
+    SDL_Event event;
+    bool haveEvent = (waitMs > 0) ? SDL_WaitEventTimeout(&event, waitMs) != 0
+                                  : SDL_PollEvent(&event) != 0;
+    while (haveEvent) {
+        switch (event.type) {
+            case SDL_QUIT:
+                push(frame, lookup(SDL_QUIT, 0, 0), 0, 0);
+                break;
+            case SDL_WINDOWEVENT:
+                // RESIZED only comes from the user / window manager,
+                // SIZE_CHANGED from any change (SDL_SetWindowSize, fullscreen, HiDPI)
+                if (event.window.event == SDL_WINDOWEVENT_RESIZED ||
+                    event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+                    frame.resized = true;
+                    frame.windowWidth = event.window.data1;
+                    frame.windowHeight = event.window.data2;
+                }
+                break;
+            case SDL_KEYDOWN:
+                // Held keys don't repeat commands
+                if (!event.key.repeat) {
+                    push(frame, lookup(SDL_KEYDOWN, event.key.keysym.sym, normalizeMods(event.key.keysym.mod)), 0, 0);
+                }
+                break;
+            case SDL_MOUSEBUTTONDOWN:
+            case SDL_MOUSEBUTTONUP:
+                push(frame, lookup(event.type, event.button.button, 0), event.button.x, event.button.y);
+                break;
+            case SDL_MOUSEMOTION:
+                push(frame, lookup(SDL_MOUSEMOTION, 0, 0), event.motion.x, event.motion.y, true);
+                break;
+        }
+
+        // Full: the rest waits in SDL's queue
+        if (frame.count == MAX_FRAME_COMMANDS) {
+            break;
+        }
+        haveEvent = SDL_PollEvent(&event) != 0;
+    }
+    return frame;
+}
@@ -0,0 +1,123 @@
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include "instrumentation.h"
+
+// -- Global heap counters
+static std::atomic<uint64_t> heapAllocations(0);
+static std::atomic<uint64_t> heapBytes(0);
+static std::atomic<uint64_t> heapFrees(0);
+
+static void* countedAlloc(std::size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    heapBytes.fetch_add(size, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+static void* countedAlignedAlloc(std::size_t size, std::align_val_t align) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    heapBytes.fetch_add(size, std::memory_order_relaxed);
+    const std::size_t alignment = static_cast<std::size_t>(align);
+    // aligned_alloc wants a multiple of the alignment
+    const std::size_t rounded = ((size ? size : 1) + alignment - 1) / alignment * alignment;
+    void* p = std::aligned_alloc(alignment, rounded);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+static void countedFree(void* p) {
+    if (p) {
+        heapFrees.fetch_add(1, std::memory_order_relaxed);
+        std::free(p);
+    }
+}
+
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try { return countedAlloc(size); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try { return countedAlloc(size); } catch (...) { return nullptr; }
+}
+void* operator new(std::size_t size, std::align_val_t align) { return countedAlignedAlloc(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align) { return countedAlignedAlloc(size, align); }
+
+void operator delete(void* p) noexcept { countedFree(p); }
+void operator delete[](void* p) noexcept { countedFree(p); }
+void operator delete(void* p, std::size_t) noexcept { countedFree(p); }
+void operator delete[](void* p, std::size_t) noexcept { countedFree(p); }
+void operator delete(void* p, std::align_val_t) noexcept { countedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { countedFree(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { countedFree(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { countedFree(p); }
+
+namespace Instrumentation {
+
+struct TrackedMemory {
+    const char* name;
+    const void* object;
+    StatsReader reader;
+};
+
+// Fixed size so registering doesn't allocate either
+static const int MAX_TRACKED = 32;
+static TrackedMemory tracked[MAX_TRACKED];
+static int trackedCount = 0;
+
+static FrameStats frameStats;
+static uint64_t frameStartAllocations = 0;
+
+uint64_t getHeapAllocations() { return heapAllocations.load(std::memory_order_relaxed); }
+uint64_t getHeapBytes() { return heapBytes.load(std::memory_order_relaxed); }
+uint64_t getHeapFrees() { return heapFrees.load(std::memory_order_relaxed); }
+
+void beginFrame() {
+    frameStartAllocations = getHeapAllocations();
+}
+
+void endFrame() {
+    const uint64_t allocations = getHeapAllocations() - frameStartAllocations;
+    ++frameStats.frames;
+    frameStats.allocationsLastFrame = allocations;
+    frameStats.totalFrameAllocations += allocations;
+    if (allocations > 0) {
+        ++frameStats.framesWithAllocations;
+    }
+    if (allocations > frameStats.maxAllocationsPerFrame) {
+        frameStats.maxAllocationsPerFrame = allocations;
+    }
+}
+
+const FrameStats& getFrameStats() { return frameStats; }
+
+void trackMemory(const char* name, const void* object, StatsReader reader) {
+    if (trackedCount < MAX_TRACKED) {
+        tracked[trackedCount++] = { name, object, reader };
+    }
+}
+
+void printReport() {
+    std::cout << "---- instrumentation" << std::endl;
+    std::cout << "heap allocations : " << getHeapAllocations()
+              << " (" << getHeapBytes() << " bytes, " << getHeapFrees() << " frees)" << std::endl;
+    std::cout << "frames : " << frameStats.frames
+              << ", with allocations : " << frameStats.framesWithAllocations
+              << ", max per frame : " << frameStats.maxAllocationsPerFrame
+              << ", total in frames : " << frameStats.totalFrameAllocations << std::endl;
+    for (int i = 0; i < trackedCount; ++i) {
+        const MemoryStats stats = tracked[i].reader(tracked[i].object);
+        std::cout << tracked[i].name << " : used " << stats.used << " / " << stats.capacity
+                  << ", peak " << stats.peak << ", allocations " << stats.allocations << std::endl;
+    }
+}
+
+}
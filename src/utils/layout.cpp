@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <cmath>
+
+#include "layout.h"
+
+// Percentage of a window dimension, rounded to nearest (integer only)
+static int percentOf(int size, int percent){
+    return (size * percent + 50) / 100;
+}
+
+void Layout::resize(int windowW, int windowH, int outputW, int outputH){
+    outputWidth = outputW;
+    outputHeight = outputH;
+    pixelsPerPointX = windowW > 0 ? float(outputW) / windowW : 1.0f;
+    pixelsPerPointY = windowH > 0 ? float(outputH) / windowH : 1.0f;
+
+    computeViewports();
+    computeProjection();
+}
+
+void Layout::setGrid(const IsometricGrid& grid){
+    const std::vector<std::vector<GridCell>>& cells = grid.getGrid();
+    hasCells = false;
+    for (int row = 0; row < grid.getHeight(); ++row) {
+        for (int col = 0; col < grid.getWidth(); ++col) {
+            if (cells[row][col].cellType == NO_RENDER) {
+                continue;
+            }
+            const int a = col - row;
+            const int b = col + row;
+            if (!hasCells) {
+                minA = maxA = a;
+                minB = maxB = b;
+                hasCells = true;
+            }
+            minA = std::min(minA, a);
+            maxA = std::max(maxA, a);
+            minB = std::min(minB, b);
+            maxB = std::max(maxB, b);
+        }
+    }
+    isoRatio = std::max(1, static_cast<int>(std::lround(grid.getIsoRatio())));
+
+    computeProjection();
+}
+
+// Calculate viewports positions based on the output size.
+void Layout::computeViewports(){
+    const int side = percentOf(outputWidth, SIDE_VIEWPORT_PERCENT);
+    const int mainHeight = percentOf(outputHeight, MAIN_VIEWPORT_HEIGHT_PERCENT);
+
+    // Main viewport (centered)
+    viewports[0] = { side, 0, outputWidth - 2 * side, mainHeight };
+    // Bottom viewport
+    viewports[1] = { side, mainHeight, outputWidth - 2 * side, outputHeight - mainHeight };
+    // Left viewport
+    viewports[2] = { 0, 0, side, outputHeight };
+    // Right viewport
+    viewports[3] = { outputWidth - side, 0, side, outputHeight };
+}
+
+void Layout::computeProjection(){
+    ++revision;
+    if (!hasCells) {
+        halfWidth = halfHeight = 0;
+        return;
+    }
+
+    // Size of the drawn area in half cells: the outermost cells stick out
+    // by half a cell left / right and a whole cell at the bottom
+    const int spanA = maxA - minA + 2;
+    const int spanB = maxB - minB + 2;
+
+    // Biggest whole pixel cell that fits, so every cell lands on the
+    // same pixel lattice without gaps
+    const SDL_Rect& main = viewports[0];
+    halfHeight = std::max(1, std::min(main.w / (spanA * isoRatio), main.h / spanB));
+    halfWidth = halfHeight * isoRatio;
+
+    // Centered
+    const int marginX = (main.w - spanA * halfWidth) / 2;
+    const int marginY = (main.h - spanB * halfHeight) / 2;
+    originX = marginX - (minA - 1) * halfWidth;
+    originY = marginY - minB * halfHeight;
+}
+
+bool Layout::pick(int windowX, int windowY, int& row, int& col) const {
+    if (halfWidth <= 0 || halfHeight <= 0) {
+        return false;
+    }
+    const SDL_Rect& main = viewports[0];
+    const float px = windowX * pixelsPerPointX - main.x;
+    const float py = windowY * pixelsPerPointY - main.y;
+    if (px < 0 || py < 0 || px >= main.w || py >= main.h) {
+        return false;
+    }
+
+    // In cell units, relative to the center of cell (0, 0)
+    const float fx = (px - originX) / halfWidth;
+    const float fy = (py - originY) / halfHeight - 1.0f;
+    // Rotate back onto the lattice, nearest cell center
+    row = static_cast<int>(std::floor((fy - fx) / 2.0f + 0.5f));
+    col = static_cast<int>(std::floor((fy + fx) / 2.0f + 0.5f));
+    return true;
+}
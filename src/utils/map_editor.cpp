@@ -0,0 +1,321 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "map_editor.h"
+#include "map_files.h"
+
+MapEditor::MapEditor(IsometricGrid& grid) : grid(grid) {
+    unsaved.assign(grid.getWidth() * grid.getHeight(), 0);
+    saver = std::thread(&MapEditor::saverLoop, this);
+}
+
+MapEditor::~MapEditor() {
+    // The save in flight first, then what it didn't cover
+    collectSave(0, true);
+    if (!filename.empty() && (!unsavedCells.empty() || fullSaveRequested)) {
+        requestSave(fullSaveRequested);
+        collectSave(0, true);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeSaver.notify_one();
+    saver.join();
+}
+
+void MapEditor::setActive(bool b) {
+    if (!b) {
+        endStroke();
+    }
+    active = b;
+}
+
+void MapEditor::setCell(int cell, CellType type) {
+    const int width = grid.getWidth();
+    grid.getGrid()[cell / width][cell % width].cellType = type;
+    changedCells.push_back(cell);
+    markUnsaved(cell);
+    ++revision;
+}
+
+void MapEditor::markUnsaved(int cell) {
+    if (!unsaved[cell]) {
+        unsaved[cell] = 1;
+        unsavedCells.push_back(static_cast<uint16_t>(cell));
+    }
+}
+
+// -- Painting
+void MapEditor::beginStroke() {
+    inStroke = true;
+    strokeRecorded = false;
+}
+
+void MapEditor::paint(int row, int col, uint32_t nowMs) {
+    GridCell* target = grid.getCell(row, col);
+    // Only cells that exist on the map, NO_RENDER marks the outside
+    if (target == nullptr || target->cellType == NO_RENDER || target->cellType == brush) {
+        return;
+    }
+
+    const bool ownStroke = !inStroke;
+    if (ownStroke) {
+        beginStroke();
+    }
+
+    // First change of the stroke: it becomes the newest undo step and
+    // whatever could be redone is dropped
+    if (!strokeRecorded) {
+        if (appliedStrokes < strokeStarts.size()) {
+            deltas.resize(strokeStarts[appliedStrokes]);
+            strokeStarts.resize(appliedStrokes);
+        }
+        strokeStarts.push_back(static_cast<uint32_t>(deltas.size()));
+        ++appliedStrokes;
+        strokeRecorded = true;
+    }
+
+    const int cell = row * grid.getWidth() + col;
+    deltas.push_back({ static_cast<uint16_t>(cell),
+                       static_cast<uint8_t>(target->cellType),
+                       static_cast<uint8_t>(brush) });
+    setCell(cell, brush);
+    lastEditTime = nowMs;
+
+    if (ownStroke) {
+        endStroke();
+    }
+}
+
+void MapEditor::endStroke() {
+    inStroke = false;
+    strokeRecorded = false;
+}
+
+// -- Undo / redo
+bool MapEditor::undo(uint32_t nowMs) {
+    endStroke();
+    if (!canUndo()) {
+        return false;
+    }
+    const size_t stroke = --appliedStrokes;
+    const size_t end = (stroke + 1 < strokeStarts.size()) ? strokeStarts[stroke + 1] : deltas.size();
+    // Backwards, a cell painted twice in a stroke ends up as it was before it
+    for (size_t i = end; i > strokeStarts[stroke]; --i) {
+        setCell(deltas[i - 1].cell, static_cast<CellType>(deltas[i - 1].before));
+    }
+    lastEditTime = nowMs;
+    return true;
+}
+
+bool MapEditor::redo(uint32_t nowMs) {
+    endStroke();
+    if (!canRedo()) {
+        return false;
+    }
+    const size_t stroke = appliedStrokes++;
+    const size_t end = (stroke + 1 < strokeStarts.size()) ? strokeStarts[stroke + 1] : deltas.size();
+    for (size_t i = strokeStarts[stroke]; i < end; ++i) {
+        setCell(deltas[i].cell, static_cast<CellType>(deltas[i].after));
+    }
+    lastEditTime = nowMs;
+    return true;
+}
+
+void MapEditor::takeChangedCells(std::vector<int>& out) {
+    out.insert(out.end(), changedCells.begin(), changedCells.end());
+    changedCells.clear();
+}
+
+void MapEditor::resetJournal() {
+    // A save still writing belongs to the previous grid
+    collectSave(0, true);
+
+    deltas.clear();
+    strokeStarts.clear();
+    appliedStrokes = 0;
+    inStroke = false;
+    strokeRecorded = false;
+    changedCells.clear();
+    unsaved.assign(grid.getWidth() * grid.getHeight(), 0);
+    unsavedCells.clear();
+    fullSaveRequested = false;
+    saveFailed = false;
+    savedRevision = revision; // what was just loaded is what is on disk
+}
+
+void MapEditor::loadEdits() {
+    const std::string path = JsonUtils::mapsFolder + filename + MapFiles::editsExtension;
+    std::vector<uint8_t> bytes;
+    if (filename.empty() || !MapFiles::readFile(path, bytes)) {
+        return; // nothing edited since the last full save
+    }
+    size_t validBytes = 0;
+    if (!MapFiles::applyEdits(grid, bytes, &validBytes)) {
+        // Written for another version of the map, appending to it would only add to the mess
+        std::cout << "Map edit log doesn't fit " << filename << ", dropped" << std::endl;
+        std::remove(path.c_str());
+        return;
+    }
+    // A record cut short (crash mid-write) would swallow the ones appended after it
+    if (validBytes < bytes.size()) {
+        bytes.resize(validBytes);
+        MapFiles::writeFile(path, bytes);
+    }
+    std::cout << "Map edits restored: " << filename << std::endl;
+}
+
+// -- Autosave
+void MapEditor::update(uint32_t nowMs) {
+    collectSave(nowMs, false);
+    if (saveInFlight || inStroke || filename.empty()) {
+        return;
+    }
+    if (saveFailed && nowMs - failedSaveTime < AUTOSAVE_DELAY_MS) {
+        return;
+    }
+    if (fullSaveRequested) {
+        requestSave(true);
+        return;
+    }
+    if (unsavedCells.empty() || nowMs - lastEditTime < AUTOSAVE_DELAY_MS) {
+        return;
+    }
+    requestSave(false);
+}
+
+void MapEditor::requestSave(bool full) {
+    SaveJob next;
+    next.name = filename;
+    next.full = full;
+    next.rows = grid.getHeight();
+    next.cols = grid.getWidth();
+    if (full) {
+        next.grid.reset(new IsometricGrid(grid));
+        fullSaveRequested = false;
+    }
+    // Only the cells, the saver does the encoding and the write
+    const int width = grid.getWidth();
+    next.types.reserve(unsavedCells.size());
+    for (uint16_t cell : unsavedCells) {
+        next.types.push_back(static_cast<uint8_t>(grid.getGrid()[cell / width][cell % width].cellType));
+        unsaved[cell] = 0;
+    }
+    next.cells = unsavedCells;
+
+    // Kept until the result is in, a failed save hands them back
+    inFlightCells.swap(unsavedCells);
+    unsavedCells.clear();
+    inFlightRevision = revision;
+    inFlightFull = full;
+    saveInFlight = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = std::move(next);
+        jobQueued = true;
+    }
+    wakeSaver.notify_one();
+}
+
+void MapEditor::collectSave(uint32_t nowMs, bool wait) {
+    if (!saveInFlight) {
+        return;
+    }
+    bool succeeded;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (wait) {
+            saveDone.wait(lock, [&] { return jobDone; });
+        }
+        if (!jobDone) {
+            return;
+        }
+        jobDone = false;
+        succeeded = jobSucceeded;
+    }
+    saveInFlight = false;
+
+    saveFailed = !succeeded;
+    if (succeeded) {
+        savedRevision = inFlightRevision;
+    }
+    else {
+        // Still dirty: retried after the usual delay, a full save as a full save
+        for (uint16_t cell : inFlightCells) {
+            markUnsaved(cell);
+        }
+        fullSaveRequested = fullSaveRequested || inFlightFull;
+        failedSaveTime = nowMs;
+    }
+    inFlightCells.clear();
+}
+
+void MapEditor::saverLoop() {
+    for (;;) {
+        SaveJob current;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeSaver.wait(lock, [&] { return stopping || jobQueued; });
+            if (!jobQueued) {
+                return; // stopping, nothing left to write
+            }
+            current = std::move(job);
+            jobQueued = false;
+        }
+
+        const bool succeeded = writeJob(current);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobDone = true;
+            jobSucceeded = succeeded;
+        }
+        saveDone.notify_one();
+    }
+}
+
+bool MapEditor::writeJob(const SaveJob& job) {
+    const std::string path = JsonUtils::mapsFolder + job.name;
+    const std::string editsPath = path + MapFiles::editsExtension;
+    std::error_code error;
+
+    if (!job.full) {
+        // Append to the edit log, a new one starts with its header
+        const uintmax_t logSize = std::filesystem::file_size(editsPath, error);
+        const bool fresh = error || logSize == 0;
+        std::vector<uint8_t> bytes;
+        if (fresh) {
+            MapFiles::encodeEditsHeader(job.rows, job.cols, bytes);
+        }
+        for (size_t i = 0; i < job.cells.size(); ++i) {
+            MapFiles::encodeEdit(job.cells[i], static_cast<CellType>(job.types[i]), bytes);
+        }
+        if (!MapFiles::writeFile(editsPath, bytes, true)) {
+            // Cut what made it to disk, the retry appends it again
+            std::filesystem::resize_file(editsPath, fresh ? 0 : logSize, error);
+            std::cout << "Map autosave failed: " << job.name << MapFiles::editsExtension << std::endl;
+            return false;
+        }
+        std::cout << "Map autosaved: " << job.name << MapFiles::editsExtension << std::endl;
+        return true;
+    }
+
+    // Write next to the map then swap it in, a crash mid-write
+    // never leaves a half written map behind
+    const std::string tmpPath = path + ".tmp";
+    bool written = MapFiles::saveGridToPath(*job.grid, tmpPath, MapFiles::isBinary(job.name));
+    if (written && std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        // Windows doesn't replace an existing file
+        std::remove(path.c_str());
+        written = std::rename(tmpPath.c_str(), path.c_str()) == 0;
+    }
+    // The log is in the map now, left behind it would replay older cells over it
+    if (!written || (std::remove(editsPath.c_str()) != 0 && std::filesystem::exists(editsPath, error))) {
+        std::cout << "Map save failed: " << job.name << std::endl;
+        return false;
+    }
+    std::cout << "Map saved: " << job.name << std::endl;
+    return true;
+}
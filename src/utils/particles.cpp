@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "particles.h"
+
+// What each EffectKind looks like. Speeds are lattice units per second,
+// gravity pulls towards +y (down the screen), negative makes it rise.
+struct EffectStyle {
+    SDL_Color color;
+    int burst; // particles per burst()
+    float rate; // particles per second while an emitter runs
+    float minLife; // seconds
+    float maxLife;
+    float speed; // along the ground, random direction
+    float rise; // straight up at spawn
+    float gravity;
+    float size; // half extent, in half cell heights
+};
+
+static const EffectStyle EFFECT_STYLES[EFFECT_KIND_COUNT] = {
+    // HIT
+    { {0xFF, 0xC0, 0x40, 0xFF}, 24, 0.0f, 0.25f, 0.5f, 3.0f, 2.0f, 10.0f, 0.12f },
+    // DUST
+    { {0xB0, 0xA0, 0x80, 0xA0}, 10, 0.0f, 0.3f, 0.6f, 1.0f, 0.3f, 0.0f, 0.2f },
+    // SMOKE
+    { {0x70, 0x70, 0x70, 0xA0}, 6, 30.0f, 0.6f, 1.2f, 0.3f, 1.0f, -0.8f, 0.25f },
+    // AURA
+    { {0x60, 0xC0, 0xFF, 0xC0}, 8, 20.0f, 0.5f, 0.9f, 0.2f, 1.5f, 0.0f, 0.1f },
+};
+
+// Widest SIMD step of integrate(), arrays are padded to it
+static const uint32_t SIMD_WIDTH = 8;
+
+// Bits of the lanes in [i, count) for a width wide step (movemask order)
+static int liveLanes(uint32_t i, uint32_t count, uint32_t width){
+    const uint32_t live = count > i ? std::min(count - i, width) : 0;
+    return static_cast<int>((1u << live) - 1);
+}
+
+// Center of cell (row, col) in lattice units
+static void cellCenter(int row, int col, float& x, float& y){
+    x = static_cast<float>(col - row);
+    y = static_cast<float>(col + row + 1);
+}
+
+ParticleSystem::ParticleSystem() : emitters(MAX_EMITTERS) {
+    posX.resize(MAX_PARTICLES);
+    posY.resize(MAX_PARTICLES);
+    velX.resize(MAX_PARTICLES);
+    velY.resize(MAX_PARTICLES);
+    gravity.resize(MAX_PARTICLES);
+    life.resize(MAX_PARTICLES);
+    invMaxLife.resize(MAX_PARTICLES);
+    fade.resize(MAX_PARTICLES);
+    size.resize(MAX_PARTICLES);
+    color.resize(MAX_PARTICLES);
+
+    // Diamonds (top, right, bottom, left) as two triangles, same for every frame
+    vertices.resize(MAX_PARTICLES * 4);
+    indices.resize(MAX_PARTICLES * 6);
+    for (uint32_t i = 0; i < MAX_PARTICLES; ++i) {
+        const int first = static_cast<int>(i * 4);
+        const int quad[6] = {first, first + 1, first + 2, first, first + 2, first + 3};
+        std::copy(quad, quad + 6, indices.begin() + i * 6);
+    }
+}
+
+float ParticleSystem::random(){
+    return (rng.next() >> 8) * (1.0f / 16777216.0f);
+}
+
+// -- Spawning
+void ParticleSystem::spawn(EffectKind kind, float x, float y){
+    if (count >= MAX_PARTICLES) {
+        return;
+    }
+    const EffectStyle& style = EFFECT_STYLES[kind];
+
+    // Anywhere on the cell: +/- half a cell along row and col
+    const float dRow = random() - 0.5f;
+    const float dCol = random() - 0.5f;
+    // Random direction on the ground, projected like the cells are
+    const float angle = random() * 6.2831853f;
+    const float speed = style.speed * (0.5f + random() * 0.5f);
+    const float groundRow = std::sin(angle) * speed;
+    const float groundCol = std::cos(angle) * speed;
+    const float maxLife = style.minLife + random() * (style.maxLife - style.minLife);
+
+    const uint32_t i = count++;
+    posX[i] = x + dCol - dRow;
+    posY[i] = y + dCol + dRow;
+    velX[i] = groundCol - groundRow;
+    velY[i] = groundCol + groundRow - style.rise;
+    gravity[i] = style.gravity;
+    life[i] = maxLife;
+    invMaxLife[i] = 1.0f / maxLife;
+    fade[i] = 1.0f;
+    size[i] = style.size;
+    color[i] = style.color;
+
+    peakCount = std::max<size_t>(peakCount, count);
+    ++spawned;
+}
+
+void ParticleSystem::burst(EffectKind kind, int row, int col, int n){
+    float x, y;
+    cellCenter(row, col, x, y);
+    if (n <= 0) {
+        n = EFFECT_STYLES[kind].burst;
+    }
+    for (int k = 0; k < n; ++k) {
+        spawn(kind, x, y);
+    }
+}
+
+ParticleSystem::Emitter* ParticleSystem::startEmitter(EffectKind kind, int row, int col, float seconds){
+    Emitter* emitter = emitters.create();
+    if (emitter == nullptr) {
+        return nullptr;
+    }
+    emitter->kind = kind;
+    cellCenter(row, col, emitter->x, emitter->y);
+    emitter->remaining = seconds > 0.0f ? seconds : -1.0f;
+    emitter->accumulator = 0.0f;
+    return emitter;
+}
+
+void ParticleSystem::moveEmitter(Emitter* emitter, int row, int col){
+    cellCenter(row, col, emitter->x, emitter->y);
+}
+
+void ParticleSystem::stopEmitter(Emitter* emitter){
+    emitters.destroy(emitter);
+}
+
+void ParticleSystem::clear(){
+    count = 0;
+    emitters.clear();
+}
+
+// -- Update
+void ParticleSystem::update(float dt){
+    if (dt <= 0.0f) {
+        return;
+    }
+
+    // Emitters first, what they spawn moves this frame too
+    emitters.forEach([&](Emitter& emitter) {
+        const EffectStyle& style = EFFECT_STYLES[emitter.kind];
+        emitter.accumulator += style.rate * dt;
+        for (; emitter.accumulator >= 1.0f; emitter.accumulator -= 1.0f) {
+            spawn(emitter.kind, emitter.x, emitter.y);
+        }
+        // Destroying the current slot is fine, forEach checks the next one
+        if (emitter.remaining >= 0.0f && (emitter.remaining -= dt) <= 0.0f) {
+            emitters.destroy(&emitter);
+        }
+    });
+
+    if (integrate(dt)) {
+        compact();
+    }
+}
+
+// Same operations in the same order on every path, only the width changes.
+// Runs up to the padded count, the padding is stale data nobody reads, so
+// its lanes are masked out of the death test: a dead or empty pad slot
+// would otherwise trigger compact() every frame.
+bool ParticleSystem::integrate(float dt){
+    const uint32_t n = (count + SIMD_WIDTH - 1) & ~(SIMD_WIDTH - 1);
+    uint32_t i = 0;
+    bool anyDead = false;
+
+#if defined(__AVX2__)
+    const __m256 step8 = _mm256_set1_ps(dt);
+    const __m256 zero8 = _mm256_setzero_ps();
+    for (; i + 8 <= n; i += 8) {
+        const __m256 vy = _mm256_add_ps(_mm256_loadu_ps(&velY[i]), _mm256_mul_ps(_mm256_loadu_ps(&gravity[i]), step8));
+        _mm256_storeu_ps(&velY[i], vy);
+        _mm256_storeu_ps(&posX[i], _mm256_add_ps(_mm256_loadu_ps(&posX[i]), _mm256_mul_ps(_mm256_loadu_ps(&velX[i]), step8)));
+        _mm256_storeu_ps(&posY[i], _mm256_add_ps(_mm256_loadu_ps(&posY[i]), _mm256_mul_ps(vy, step8)));
+        const __m256 left = _mm256_sub_ps(_mm256_loadu_ps(&life[i]), step8);
+        _mm256_storeu_ps(&life[i], left);
+        _mm256_storeu_ps(&fade[i], _mm256_mul_ps(left, _mm256_loadu_ps(&invMaxLife[i])));
+        anyDead |= (_mm256_movemask_ps(_mm256_cmp_ps(left, zero8, _CMP_LE_OQ)) & liveLanes(i, count, 8)) != 0;
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128 step = _mm_set1_ps(dt);
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4) {
+        const __m128 vy = _mm_add_ps(_mm_loadu_ps(&velY[i]), _mm_mul_ps(_mm_loadu_ps(&gravity[i]), step));
+        _mm_storeu_ps(&velY[i], vy);
+        _mm_storeu_ps(&posX[i], _mm_add_ps(_mm_loadu_ps(&posX[i]), _mm_mul_ps(_mm_loadu_ps(&velX[i]), step)));
+        _mm_storeu_ps(&posY[i], _mm_add_ps(_mm_loadu_ps(&posY[i]), _mm_mul_ps(vy, step)));
+        const __m128 left = _mm_sub_ps(_mm_loadu_ps(&life[i]), step);
+        _mm_storeu_ps(&life[i], left);
+        _mm_storeu_ps(&fade[i], _mm_mul_ps(left, _mm_loadu_ps(&invMaxLife[i])));
+        anyDead |= (_mm_movemask_ps(_mm_cmple_ps(left, zero)) & liveLanes(i, count, 4)) != 0;
+    }
+#endif
+    for (; i < n; ++i) {
+        velY[i] += gravity[i] * dt;
+        posX[i] += velX[i] * dt;
+        posY[i] += velY[i] * dt;
+        life[i] -= dt;
+        fade[i] = life[i] * invMaxLife[i];
+        anyDead |= i < count && life[i] <= 0.0f;
+    }
+    return anyDead;
+}
+
+void ParticleSystem::compact(){
+    uint32_t i = 0;
+    while (i < count) {
+        if (life[i] > 0.0f) {
+            ++i;
+            continue;
+        }
+        // Last live particle into the hole, i gets checked again
+        const uint32_t last = --count;
+        posX[i] = posX[last];
+        posY[i] = posY[last];
+        velX[i] = velX[last];
+        velY[i] = velY[last];
+        gravity[i] = gravity[last];
+        life[i] = life[last];
+        invMaxLife[i] = invMaxLife[last];
+        fade[i] = fade[last];
+        size[i] = size[last];
+        color[i] = color[last];
+    }
+}
+
+// -- Drawing
+uint32_t ParticleSystem::buildVertices(const Layout& layout){
+    const float halfW = static_cast<float>(layout.getCellWidth() / 2);
+    const float halfH = static_cast<float>(layout.getCellHeight() / 2);
+    if (halfW <= 0.0f || halfH <= 0.0f) {
+        return 0;
+    }
+    int originX, originY;
+    layout.cellTop(0, 0, originX, originY);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        const float x = originX + posX[i] * halfW;
+        const float y = originY + posY[i] * halfH;
+        // Fades out and keeps a 1 pixel minimum, small cells still show something
+        const float s = std::max(1.0f, size[i] * halfH);
+        SDL_Color c = color[i];
+        c.a = static_cast<Uint8>(c.a * std::min(1.0f, std::max(0.0f, fade[i])));
+
+        SDL_Vertex* v = &vertices[i * 4];
+        v[0] = {{x, y - s}, c, {0, 0}};
+        v[1] = {{x + s * 2.0f, y}, c, {0, 0}};
+        v[2] = {{x, y + s}, c, {0, 0}};
+        v[3] = {{x - s * 2.0f, y}, c, {0, 0}};
+    }
+    return count;
+}
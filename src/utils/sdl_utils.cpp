@@ -1,11 +1,31 @@
+#include <cstdlib>
 #include <iostream>
 #include <stdexcept>
 
 #include "json_utils.h"
+#include "map_files.h"
 #include "sdl_utils.h"
 
+// Cell fill colors [type][hidden][dark], NO_RENDER cells are never drawn
+static const SDL_Color CELL_COLORS[3][2][2] = {
+    // WALKABLE
+    { { {0xAA, 0xAA, 0xAA, 0xFF}, {0x55, 0x55, 0x55, 0xFF} },
+      { {0x50, 0x50, 0x50, 0xFF}, {0x30, 0x30, 0x30, 0xFF} } },
+    // EMPTY, a hole barely lighter than the background
+    { { {0x2C, 0x2C, 0x2C, 0xFF}, {0x28, 0x28, 0x28, 0xFF} },
+      { {0x26, 0x26, 0x26, 0xFF}, {0x24, 0x24, 0x24, 0xFF} } },
+    // OBSTACLE
+    { { {0x8B, 0x5A, 0x2B, 0xFF}, {0x6E, 0x47, 0x22, 0xFF} },
+      { {0x45, 0x2D, 0x15, 0xFF}, {0x37, 0x24, 0x11, 0xFF} } },
+};
+
+static SDL_Color cellColor(CellType type, bool hidden, bool dark){
+    const int t = (type == EMPTY || type == OBSTACLE) ? type : WALKABLE;
+    return CELL_COLORS[t][hidden ? 1 : 0][dark ? 1 : 0];
+}
+
 // -- Constructor
-SDLResources::SDLResources(){
+SDLResources::SDLResources() : mapEditor(isometricGrid) {
     window = nullptr;
     renderer = nullptr;
     quit = NULL;
@@ -13,7 +33,7 @@ SDLResources::SDLResources(){
     windowHeight = NULL;
 };
 
-SDLResources::SDLResources(const char* title, const int width, const int height) {
+SDLResources::SDLResources(const char* title, const int width, const int height) : mapEditor(isometricGrid) {
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
         SDL_Quit();
         throw std::runtime_error("SDL could not initialize! SDL_Error: " + std::string(SDL_GetError()));
@@ -24,19 +44,30 @@ SDLResources::SDLResources(const char* title, const int width, const int height)
         throw std::runtime_error("SDL could set filtering! SDL_Error: " + std::string(SDL_GetError()));
     }
 
-    window = SDL_CreateWindow(title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width, height, SDL_WINDOW_RESIZABLE);
+    window = SDL_CreateWindow(title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width, height,
+                              SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
     if (window == nullptr) {
         SDL_Quit();
         throw std::runtime_error("Window could not be created! SDL_Error: " + std::string(SDL_GetError()));
     }
 
     renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    if (renderer == nullptr) {
+        // No GPU (headless / server), fall back to SDL's software renderer
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
+    }
     if (renderer == nullptr) {
         SDL_DestroyWindow(window);
         SDL_Quit();
         throw std::runtime_error("Renderer could not be created! SDL_Error: " + std::string(SDL_GetError()));
     }
 
+    // Grid gets rasterized on the CPU when the renderer has no GPU backing
+    SDL_RendererInfo rendererInfo;
+    if (SDL_GetRendererInfo(renderer, &rendererInfo) == 0) {
+        softwareRendering = (rendererInfo.flags & SDL_RENDERER_SOFTWARE) != 0;
+    }
+
     // // Initialize renderer color
     // SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
     
@@ -58,6 +89,9 @@ SDLResources::SDLResources(const char* title, const int width, const int height)
 
 // -- Destructor
 SDLResources::~SDLResources() {
+    if (gridTexture) {
+        SDL_DestroyTexture(gridTexture);
+    }
     if (renderer) {
         SDL_DestroyRenderer(renderer);
     }
@@ -75,38 +109,125 @@ SDLResources::~SDLResources() {
 // Setters
 void SDLResources::loadMap(std::string filename){
     // Get reference to the vector2D inside IsometricGrid object.
-    JsonUtils::loadGridFromJson(isometricGrid, filename);
+    MapFiles::loadGrid(isometricGrid, filename);
+    mapFilename = filename;
+    mapEditor.setFilename(filename);
+    mapEditor.resetJournal();
+    // What the editor autosaved last time goes on top
+    mapEditor.loadEdits();
+    layout.setGrid(isometricGrid);
+    gridGeometryDirty = true;
 }
 
 // -- Event Handling
-void SDLResources::processEvents(){
-    SDL_Event event;
-    while (SDL_PollEvent(&event)) {
-        
-        switch (event.type) {
-            case SDL_QUIT:
-                quit = true;
-                break;
-            case SDL_WINDOWEVENT:
-                if (event.window.event == SDL_WINDOWEVENT_RESIZED) {
-                    // Handle window resize event if needed
-                    windowWidth = event.window.data1;
-				    windowHeight = event.window.data2;
-                    // Flag to indicate the size changed
-                    windowResized = true;
-                }
-                break;
-        }
+void SDLResources::processEvents(Arena& frameArena, int waitMs){
+    const InputFrame frame = input.poll(frameArena, waitMs);
+
+    // Only the last size of the frame, the layout is computed once and
+    // before any picking
+    if (frame.resized) {
+        windowWidth = frame.windowWidth;
+        windowHeight = frame.windowHeight;
+        calculateViewportsPos();
+    }
+
+    for (size_t i = 0; i < frame.count; ++i) {
+        handleCommand(frame.commands[i]);
+    }
+
+    applyEditedCells();
+    mapEditor.update(SDL_GetTicks());
+}
+
+void SDLResources::handleCommand(const CommandEvent& event){
+    switch (event.command) {
+        case QUIT_GAME:
+            quit = true;
+            break;
+        case TOGGLE_FULLSCREEN:
+            toggleFullscreen();
+            break;
+        case TOGGLE_EDITOR:
+            setEditing(!mapEditor.isActive());
+            break;
+        default:
+            break;
+    }
+    if (!mapEditor.isActive()) {
+        return;
+    }
+
+    // Map editor only
+    switch (event.command) {
+        case BRUSH_WALKABLE: mapEditor.setBrush(WALKABLE); break;
+        case BRUSH_OBSTACLE: mapEditor.setBrush(OBSTACLE); break;
+        case BRUSH_EMPTY: mapEditor.setBrush(EMPTY); break;
+        case UNDO_EDIT: mapEditor.undo(SDL_GetTicks()); break;
+        case REDO_EDIT: mapEditor.redo(SDL_GetTicks()); break;
+        case SAVE_MAP: mapEditor.requestFullSave(); break;
+        case PAINT_PRESS:
+            painting = true;
+            mapEditor.beginStroke();
+            paintAt(event.x, event.y);
+            break;
+        case PAINT_RELEASE:
+            painting = false;
+            mapEditor.endStroke();
+            break;
+        case POINTER_MOVED:
+            // Motions are already merged, one pick per frame at most
+            if (painting) {
+                paintAt(event.x, event.y);
+            }
+            break;
+        default:
+            break;
     }
 }
 
-void SDLResources::screenToGrid(int mouseX, int mouseY, int &gridX, int &gridY) {
-    int tempX = mouseX - 400;  // Adjust based on your grid position
-    int tempY = mouseY - 100;  // Adjust based on your grid position
+bool SDLResources::screenToGrid(int mouseX, int mouseY, int &gridX, int &gridY) {
+    int row, col;
+    if (!layout.pick(mouseX, mouseY, row, col)) {
+        return false;
+    }
+    const GridCell* cell = isometricGrid.getCell(row, col);
+    if (cell == nullptr || cell->cellType == NO_RENDER) {
+        return false;
+    }
+    gridX = row;
+    gridY = col;
+    return true;
+}
 
-    // Convert screen coordinates to isometric grid coordinates
-    // gridX = (tempY / TILE_HEIGHT) + (tempX / TILE_WIDTH);
-    // gridY = (tempY / TILE_HEIGHT) - (tempX / TILE_WIDTH);
+// -- Map editor
+void SDLResources::setEditing(bool b){
+    mapEditor.setActive(b);
+    painting = false;
+    // Fog and units are only shown outside of the editor
+    visibilityApplied = false;
+}
+
+void SDLResources::paintAt(int mouseX, int mouseY){
+    int row, col;
+    if (screenToGrid(mouseX, mouseY, row, col)) {
+        mapEditor.paint(row, col, SDL_GetTicks());
+    }
+}
+
+void SDLResources::applyEditedCells(){
+    editedCells.clear();
+    mapEditor.takeChangedCells(editedCells);
+    if (gridGeometryDirty) {
+        return; // the rebuild reads the new types anyway
+    }
+    const int width = isometricGrid.getWidth();
+    for (int cell : editedCells) {
+        const int i = geometryIndex[cell];
+        if (i >= 0) {
+            cellGeometry[i].type = isometricGrid.getGrid()[cell / width][cell % width].cellType;
+            updateCellColor(i);
+        }
+    }
 }
 
 
@@ -123,6 +244,12 @@ void SDLResources::setDrawColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
     SDL_SetRenderDrawColor(renderer, r, g, b, a);
 }
 
+void SDLResources::toggleFullscreen() {
+    // Desktop fullscreen, the resize event that follows updates the layout
+    const bool fullscreen = (SDL_GetWindowFlags(window) & SDL_WINDOW_FULLSCREEN) != 0;
+    SDL_SetWindowFullscreen(window, fullscreen ? 0 : SDL_WINDOW_FULLSCREEN_DESKTOP);
+}
+
 
 // -- Drawing primitives
 void SDLResources::drawRect(const SDL_Rect& rect) {
@@ -190,11 +317,6 @@ void SDLResources::render(){
 // -- Viewports functions
 // Render all viewports
 void SDLResources::renderViewports(){
-    if (windowResized){
-        calculateViewportsPos();
-        windowResized = false;
-    }
-
     renderMainViewport();
     renderBottomViewport();
     renderLeftViewport();
@@ -204,44 +326,21 @@ void SDLResources::renderViewports(){
 // Render a single viewport
 void SDLResources::renderViewportBackground(int idx, int r, int g, int b){
     // idx 0 = main / 1 = bottom / 2 = left / 3 = right
-    SDL_RenderSetViewport(renderer, &viewports[idx]);
+    SDL_RenderSetViewport(renderer, &layout.getViewport(idx));
     SDL_SetRenderDrawColor(renderer, r, g, b, 255);
     SDL_RenderFillRect(renderer, NULL);
 }
 
-// Calculate viewports positions based on window size.
+// Viewports and grid projection for the current window size. Drawing is
+// in renderer pixels, which on HiDPI screens isn't the window size.
 void SDLResources::calculateViewportsPos(){
-    // Main viewport (centered)
-    viewports[0] = { 
-        static_cast<int>(std::round(0.15 * windowWidth)), 
-        0, 
-        static_cast<int>(std::round(0.70 * windowWidth)), 
-        static_cast<int>(std::round(0.80 * windowHeight)) 
-    };
-
-    // Bottom viewport
-    viewports[1] = { 
-        static_cast<int>(std::round(0.15 * windowWidth)), 
-        static_cast<int>(std::round(0.80 * windowHeight)), 
-        static_cast<int>(std::round(0.70 * windowWidth)), 
-        static_cast<int>(std::round(0.20 * windowHeight)) 
-    };
-
-    // Left viewport
-    viewports[2] = { 
-        0, 
-        0, 
-        static_cast<int>(std::round(0.15 * windowWidth)), 
-        windowHeight 
-    };
-
-    // Right viewport
-    viewports[3] = { 
-        static_cast<int>(std::round(0.85 * windowWidth)), 
-        0, 
-        static_cast<int>(std::round(0.15 * windowWidth)), 
-        windowHeight 
-    };
+    int outputWidth = windowWidth;
+    int outputHeight = windowHeight;
+    if (renderer) {
+        SDL_GetRendererOutputSize(renderer, &outputWidth, &outputHeight);
+    }
+    layout.resize(windowWidth, windowHeight, outputWidth, outputHeight);
+    gridGeometryDirty = true;
 }
 
 void SDLResources::renderMainViewport(){
@@ -260,176 +359,303 @@ void SDLResources::renderBottomViewport(){
 
 void SDLResources::renderLeftViewport(){
     renderViewportBackground(2, 0, 0, 0);
+
+    // Current brush while editing
+    if (mapEditor.isActive()) {
+        const SDL_Color color = cellColor(mapEditor.getBrush(), false, false);
+        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+        const int w = layout.getViewport(2).w / 2;
+        drawFilledDiamond(layout.getViewport(2).w / 2, w / 2, w, w / 2);
+    }
 }
 
 void SDLResources::renderRightViewport(){
     renderViewportBackground(3, 0, 0, 0);
 }
 
-void SDLResources::drawIsometricGrid(){
-    std::vector<std::vector<GridCell>>& grid = isometricGrid.getGrid();
-    float x, y, baseX, baseY;
-    float cellWidth, cellHeight;
-    
-    const float baseCellWidth = isometricGrid.getCellWidth();
-    const float baseCellHeight = isometricGrid.getCellHeight();   
-    const float baseViewportWidth = isometricGrid.getViewportWidth();
-    const float baseViewportHeight = isometricGrid.getViewportHeight();
+// Project every cell once with the current layout. Only runs after a
+// resize or a map change, drawing a frame is then just replaying the cache.
+void SDLResources::rebuildGridGeometry(){
+    const std::vector<std::vector<GridCell>>& grid = isometricGrid.getGrid();
 
-    const float currentViewportWidth = viewports[0].w;
-    const float currentViewportHeight = viewports[0].h;
+    cachedCellWidth = layout.getCellWidth();
+    cachedCellHeight = layout.getCellHeight();
 
-    // if current viewport size != base viewport size, recalculate cell size
-    if (currentViewportWidth != baseViewportWidth){
-        std::cout << "---- 1" << std::endl;
-        std::cout << "---- currentViewportWidth : " << currentViewportWidth << std::endl;
-        std::cout << "---- baseViewportWidth : " << baseViewportWidth << std::endl;
-        cellWidth = (baseCellWidth * currentViewportWidth) / baseViewportWidth;
-        cellHeight = (baseCellHeight * currentViewportHeight) / baseViewportHeight;
-    }
-    else {
-        std::cout << "---- 2" << std::endl;
-        cellWidth = baseCellWidth;
-        cellHeight = baseCellHeight;
+    // Board cell (row, col) is grid cell (row, col), unless the map was
+    // resized since the battle started
+    const Sim::Board* board = battle ? &battle->getBoard() : nullptr;
+
+    cellGeometry.clear();
+    geometryIndex.assign(isometricGrid.getWidth() * isometricGrid.getHeight(), -1);
+    gridVertices.clear();
+    gridIndices.clear();
+    outlineVertices.clear();
+    outlineIndices.clear();
+
+    for (int h = 0; h < isometricGrid.getHeight(); ++h) {
+        for (int w = 0; w < isometricGrid.getWidth(); ++w) {
+            const GridCell& cell = grid[h][w];
+            if (cell.cellType == CellType::NO_RENDER) {
+                continue;
+            }
+
+            int x, y;
+            layout.cellTop(h, w, x, y);
+            const bool dark = ((h + w) % 2 != 0); // checkerboard
+            const int gridIndex = h * isometricGrid.getWidth() + w;
+            geometryIndex[gridIndex] = static_cast<int>(cellGeometry.size());
+            const Sim::GridPos pos = { static_cast<int16_t>(h), static_cast<int16_t>(w) };
+            const int boardIndex = (board && board->inBounds(pos)) ? board->index(pos) : -1;
+            cellGeometry.push_back({x, y, dark, false, cell.cellType, gridIndex, boardIndex});
+
+            // Filled diamond as two triangles (top, right, bottom, left)
+            const SDL_Color color = cellColor(cell.cellType, false, dark);
+            const float fx = static_cast<float>(x);
+            const float fy = static_cast<float>(y);
+            const float halfW = static_cast<float>(cachedCellWidth / 2);
+            const float halfH = static_cast<float>(cachedCellHeight / 2);
+            const int first = static_cast<int>(gridVertices.size());
+            gridVertices.push_back({{fx, fy}, color, {0, 0}});
+            gridVertices.push_back({{fx + halfW, fy + halfH}, color, {0, 0}});
+            gridVertices.push_back({{fx, fy + cachedCellHeight}, color, {0, 0}});
+            gridVertices.push_back({{fx - halfW, fy + halfH}, color, {0, 0}});
+            const int quad[6] = {first, first + 1, first + 2, first, first + 2, first + 3};
+            gridIndices.insert(gridIndices.end(), quad, quad + 6);
+
+            // Outline: ring between the diamond and the same diamond 1 pixel
+            // thinner (vertically, ratio times that horizontally), inside the cell
+            const SDL_Color black = {0, 0, 0, 255};
+            const float insetX = halfH > 0 ? halfW / halfH : 1.0f;
+            const int ring = static_cast<int>(outlineVertices.size());
+            outlineVertices.push_back({{fx, fy}, black, {0, 0}});
+            outlineVertices.push_back({{fx + halfW, fy + halfH}, black, {0, 0}});
+            outlineVertices.push_back({{fx, fy + cachedCellHeight}, black, {0, 0}});
+            outlineVertices.push_back({{fx - halfW, fy + halfH}, black, {0, 0}});
+            outlineVertices.push_back({{fx, fy + 1.0f}, black, {0, 0}});
+            outlineVertices.push_back({{fx + halfW - insetX, fy + halfH}, black, {0, 0}});
+            outlineVertices.push_back({{fx, fy + cachedCellHeight - 1.0f}, black, {0, 0}});
+            outlineVertices.push_back({{fx - halfW + insetX, fy + halfH}, black, {0, 0}});
+            for (int edge = 0; edge < 4; ++edge) {
+                const int outer = ring + edge;
+                const int outerNext = ring + (edge + 1) % 4;
+                const int inner = outer + 4;
+                const int innerNext = outerNext + 4;
+                const int strip[6] = {outer, outerNext, innerNext, outer, innerNext, inner};
+                outlineIndices.insert(outlineIndices.end(), strip, strip + 6);
+            }
+        }
     }
 
-    std::cout << "---- drawIsometricGrid" << std::endl;
+    gridGeometryDirty = false;
+    visibilityApplied = false;
+}
 
-    
-    std::cout << "pls : " << isometricGrid.getGrid()[0][14].x << std::endl;
-    std::cout << "pls : " << cellWidth << std::endl;
-    std::cout << "pls : " << cellHeight << std::endl;
+void SDLResources::applyVisibility(){
+    const bool fog = vision != nullptr && !mapEditor.isActive();
+    if (visibilityApplied && (!fog || vision->getRevision() == appliedVisionRevision)) {
+        return;
+    }
 
+    for (size_t i = 0; i < cellGeometry.size(); ++i) {
+        CellGeometry& cell = cellGeometry[i];
+        cell.hidden = fog && cell.boardIndex >= 0 && !vision->isVisible(viewerTeam, cell.boardIndex);
+        updateCellColor(i);
+    }
 
-    // It prints a different value here
-    
+    if (fog) {
+        appliedVisionRevision = vision->getRevision();
+    }
+    visibilityApplied = true;
+}
 
-    //Draw the grid
-    for (int h = 0; h < isometricGrid.getCellHeight(); ++h) {
-        for (int w = 0; w < isometricGrid.getWidth(); ++w) {
-            // std::cout << "-" << std::endl;
-            // std::cout << grid[h][w].cellType << std::endl;
-            // std::cout << grid[0][14].cellType << std::endl;
-
-            if (grid[h][w].cellType != CellType::NO_RENDER){
-
-                baseX = grid[h][w].x;
-                baseY = grid[h][w].y;
-                
-                x = (baseX * currentViewportWidth) / baseViewportWidth;
-                y = (baseY * currentViewportHeight) / baseViewportHeight; 
-
-                if (w % 2 == 0) {
-                    SDL_SetRenderDrawColor(renderer, 0xAA, 0xAA, 0xAA, 0xFF);
-                } else {
-                    SDL_SetRenderDrawColor(renderer, 0x55, 0x55, 0x55, 0xFF);
-                }
-
-                // Draw diamond
-                drawFilledDiamond(x, y, cellWidth, cellHeight);
-
-                // // Draw outline
-                SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-                drawDiamond(x, y, cellWidth, cellHeight);
-            }
-        }
+void SDLResources::updateCellColor(size_t i){
+    const CellGeometry& cell = cellGeometry[i];
+    const SDL_Color color = cellColor(cell.type, cell.hidden, cell.dark);
+    for (size_t v = i * 4; v < i * 4 + 4; ++v) {
+        gridVertices[v].color = color;
     }
 }
 
-// Drawing the grid and save to bleh.json
-void SDLResources::drawIsometricGridThenCreateGridObject() {
-    // Get const info from IsometricGrid object
-    float renderedGridWidth = isometricGrid.getRenderedGridWidth();
-    float renderedGridHeight = isometricGrid.getRenderedGridHeight();
-    float isoRatio = isometricGrid.getIsoRatio();
-    
-    
-    // Get viewport dimensions
-    int viewportWidth = viewports[0].w;
-    int viewportHeight = viewports[0].h;
+void SDLResources::drawIsometricGrid(){
+    if (gridGeometryDirty) {
+        rebuildGridGeometry();
+    }
+    applyVisibility();
 
-    // Calculate grid and viewport ratio
-    float gridRatio = float(renderedGridWidth) / (renderedGridHeight);
-    float viewportRatio = float(viewportWidth) / (viewportHeight * isoRatio);
+    if (softwareRendering) {
+        drawIsometricGridSoftware();
+        return;
+    }
 
-    float cellWidth, cellHeight;
+    // All the cells in one call (needs SDL >= 2.0.18)
+    SDL_RenderGeometry(renderer, NULL,
+                       gridVertices.data(), static_cast<int>(gridVertices.size()),
+                       gridIndices.data(), static_cast<int>(gridIndices.size()));
 
-    // See if we want to calculate the tile width or height first
-    // based on the ratio of our viewport
-    // (So we can have extra space at the left/right or top/bottom)
-    if (viewportRatio <= gridRatio){
-        cellWidth = static_cast<float>(viewportWidth) / renderedGridWidth;
-        cellWidth = round(cellWidth);
-        cellHeight = cellWidth / isoRatio;
+    // Outlines, one more call whatever the number of cells
+    SDL_RenderGeometry(renderer, NULL,
+                       outlineVertices.data(), static_cast<int>(outlineVertices.size()),
+                       outlineIndices.data(), static_cast<int>(outlineIndices.size()));
+
+    drawUnits();
+    drawEffects();
+}
+
+bool SDLResources::unitScreenPos(const Sim::Unit& unit, int& x, int& y) const {
+    if (unit.pos.row < 0 || unit.pos.row >= isometricGrid.getHeight() ||
+        unit.pos.col < 0 || unit.pos.col >= isometricGrid.getWidth()) {
+        return false;
     }
-    else{
-        cellHeight = static_cast<float>(viewportHeight) / renderedGridHeight;
-        cellHeight = round(cellHeight);
-        cellWidth = cellHeight * isoRatio;
+    const int gridIndex = unit.pos.row * isometricGrid.getWidth() + unit.pos.col;
+    if (gridIndex >= static_cast<int>(geometryIndex.size()) || geometryIndex[gridIndex] < 0) {
+        return false;
+    }
+    const CellGeometry& cell = cellGeometry[geometryIndex[gridIndex]];
+    // Enemies in the fog aren't shown
+    if (cell.hidden && unit.team != viewerTeam) {
+        return false;
     }
+    x = cell.x;
+    y = cell.y;
+    return true;
+}
 
-    // Apply an offset so the gris is always centered
-    float x_offset = (viewportWidth - (cellWidth * renderedGridWidth)) / 2;
-    // Since the point x of our grid is at the center top, we need to offset
-    // be half the witdh of a cell
-    x_offset -= (cellWidth/2);
-    float y_offset = (viewportHeight - (cellHeight * renderedGridHeight)) / 2;
+void SDLResources::drawUnits(){
+    // The battle is paused while editing and may not match the map anymore
+    if (battle == nullptr || mapEditor.isActive()) {
+        return;
+    }
+    // Half size diamond centered in the cell, blue team 0 / red team 1
+    for (const Sim::Unit& unit : battle->getUnits()) {
+        int x, y;
+        if (!unit.isAlive() || !unitScreenPos(unit, x, y)) {
+            continue;
+        }
+        if (unit.team == 0) {
+            SDL_SetRenderDrawColor(renderer, 0x30, 0x60, 0xE0, 0xFF);
+        } else {
+            SDL_SetRenderDrawColor(renderer, 0xE0, 0x30, 0x30, 0xFF);
+        }
+        drawFilledDiamond(x, y + cachedCellHeight / 4, cachedCellWidth / 2, cachedCellHeight / 2);
+    }
+}
 
-    // We first draw the the Top side then the bottom side, left to right
-    // If we have obstacles, it will prevent having texture on each other.
+void SDLResources::drawEffects(){
+    if (mapEditor.isActive()) {
+        return;
+    }
+    const uint32_t count = effects.buildVertices(layout);
+    if (count == 0) {
+        return;
+    }
+    // Particles fade out through their alpha
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_RenderGeometry(renderer, NULL,
+                       effects.getVertices(), static_cast<int>(count * 4),
+                       effects.getIndices(), static_cast<int>(count * 6));
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+}
 
-    const int gridWidth = 33;
-    const int gridHeight = 33;
+void SDLResources::drawIsometricGridSoftware(){
+    const int viewportWidth = layout.getViewport(0).w;
+    const int viewportHeight = layout.getViewport(0).h;
+    if (viewportWidth <= 0 || viewportHeight <= 0) {
+        return;
+    }
 
-    int xGrid;
-    int yGrid;
-    std::vector<std::vector<GridCell>>& isoGrid = isometricGrid.getGrid();
+    // (Re)create the streaming texture when the main viewport changed size
+    if (gridTexture == nullptr || gridTextureWidth != viewportWidth || gridTextureHeight != viewportHeight) {
+        if (gridTexture) {
+            SDL_DestroyTexture(gridTexture);
+        }
+        gridTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                                        SDL_TEXTUREACCESS_STREAMING, viewportWidth, viewportHeight);
+        if (gridTexture == nullptr) {
+            throw std::runtime_error("Grid texture could not be created! SDL_Error: " + std::string(SDL_GetError()));
+        }
+        gridTextureWidth = viewportWidth;
+        gridTextureHeight = viewportHeight;
+    }
 
-    for (int line = renderedGridWidth; line > 0; --line) {
-        // x index to fill the IsometricGrid object
-        int xGrid = renderedGridWidth - line;
-        
-        // Number of grid to draw for each line
-        int numberOfGridToDraw = ((renderedGridWidth - line) * 2) + 1;
-        
-        for (int grid = 0; grid < numberOfGridToDraw; ++grid) {
-            // y index to fill the IsometricGrid object
-            yGrid = grid + (14 - (numberOfGridToDraw / 2));
-            
-            // top point of cell on screen
-            float x = (cellWidth * line) + ((cellWidth/2) * grid) + x_offset;
-            float y = ((cellHeight/2) * grid) + y_offset;
+    void* pixels;
+    int pitch;
+    if (SDL_LockTexture(gridTexture, NULL, &pixels, &pitch) != 0) {
+        return;
+    }
+    rasterizer.setTarget(pixels, pitch, viewportWidth, viewportHeight);
 
-            // Add the cell to the IsometricGrad object
-            isoGrid[xGrid][yGrid].x = x;
-            isoGrid[xGrid][yGrid].y = y;
-            isoGrid[xGrid][yGrid].cellType = WALKABLE;
+    // Same background as renderMainViewport
+    rasterizer.clear(SoftRasterizer::packColor(35, 35, 35));
 
-            if (grid % 2 == 0) {
-                SDL_SetRenderDrawColor(renderer, 0xAA, 0xAA, 0xAA, 0xFF);
-            } else {
-                SDL_SetRenderDrawColor(renderer, 0x55, 0x55, 0x55, 0xFF);
+    const uint32_t outlineColor = SoftRasterizer::packColor(0, 0, 0);
+
+    for (const CellGeometry& cell : cellGeometry) {
+        const SDL_Color color = cellColor(cell.type, cell.hidden, cell.dark);
+        rasterizer.fillDiamond(cell.x, cell.y, cachedCellWidth, cachedCellHeight,
+                               SoftRasterizer::packColor(color.r, color.g, color.b), outlineColor);
+    }
+
+    if (battle && !mapEditor.isActive()) {
+        const uint32_t teamColors[2] = { SoftRasterizer::packColor(0x30, 0x60, 0xE0),
+                                         SoftRasterizer::packColor(0xE0, 0x30, 0x30) };
+        for (const Sim::Unit& unit : battle->getUnits()) {
+            int x, y;
+            if (!unit.isAlive() || !unitScreenPos(unit, x, y)) {
+                continue;
             }
+            const uint32_t color = teamColors[unit.team == 0 ? 0 : 1];
+            rasterizer.fillDiamond(x, y + cachedCellHeight / 4, cachedCellWidth / 2, cachedCellHeight / 2,
+                                   color, color);
+        }
+    }
 
-            // Draw diamond
-            drawFilledDiamond(x, y, cellWidth, cellHeight);
+    // Effects, from the same vertices as the GPU path. No blending on the
+    // CPU, particles are drawn opaque until they die.
+    if (!mapEditor.isActive()) {
+        const uint32_t count = effects.buildVertices(layout);
+        const SDL_Vertex* vertices = effects.getVertices();
+        for (uint32_t i = 0; i < count; ++i) {
+            const SDL_Vertex* v = &vertices[i * 4];
+            const uint32_t color = SoftRasterizer::packColor(v[0].color.r, v[0].color.g, v[0].color.b);
+            rasterizer.fillDiamond(static_cast<int>(v[0].position.x), static_cast<int>(v[0].position.y),
+                                   static_cast<int>(v[1].position.x - v[3].position.x),
+                                   static_cast<int>(v[2].position.y - v[0].position.y), color, color);
+        }
+    }
 
-            // Draw outline
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-            drawDiamond(x, y, cellWidth, cellHeight);
+    SDL_UnlockTexture(gridTexture);
+
+    // The main viewport is still set, the texture covers it exactly
+    SDL_RenderCopy(renderer, gridTexture, NULL, NULL);
+}
+
+// Default map shape and save to bleh.json
+void SDLResources::drawIsometricGridThenCreateGridObject() {
+    // Get const info from IsometricGrid object
+    int renderedGridWidth = isometricGrid.getRenderedGridWidth();
+    int renderedGridHeight = isometricGrid.getRenderedGridHeight();
+
+    // Same walk as drawIsometricGridDefault, with a 2x1 cell and no offset:
+    // top points land on the lattice and get snapped to grid positions
+    const float cellWidth = 2;
+    const float cellHeight = 1;
+    std::vector<ScreenCell> cells;
+
+    // Top side
+    for (int line = renderedGridWidth; line > 0; --line) {
+        int numberOfGridToDraw = ((renderedGridWidth - line) * 2) + 1;
+        for (int grid = 0; grid < numberOfGridToDraw; ++grid) {
+            float x = (cellWidth * line) + ((cellWidth/2) * grid);
+            float y = ((cellHeight/2) * grid);
+            cells.push_back({x, y, WALKABLE, false});
         }
     }
 
-    // Draw the grid bottom side.
+    // Bottom side
     for (int line = 1; line < renderedGridHeight; ++line) {
-        
         int numberOfGridToDraw;
-        
-        // Number of grid to draw isn't linear for each new line 
-        // because we have a rectangle shape.
-        // We need to compensate because height > width
-        // Also the line starting from the corner was drawn by the loop above
-        // hence the two "-1" in the following lines
+        // Number of grid to draw isn't linear because we have a rectangle shape.
+        // The line starting from the corner was done by the loop above
         if (line <= (renderedGridHeight - renderedGridWidth)){
             numberOfGridToDraw = ((renderedGridWidth - 1) * 2) + 1;
         }
@@ -437,46 +663,17 @@ void SDLResources::drawIsometricGridThenCreateGridObject() {
             numberOfGridToDraw = ((renderedGridHeight - line - 1) * 2) + 1;
         }
 
-        // x index to fill the IsometricGrid object
-        xGrid = line + renderedGridWidth - 1;
-
         for (int grid = 0; grid < numberOfGridToDraw; ++grid) {
-            // y index to fill the IsometricGrid object
-            yGrid = grid + 1;
-
-            // Calculate isometric coordinates
-            float x = (cellWidth/2 * grid) + cellWidth + x_offset;
-            float y = (cellHeight/2 * grid) + (cellHeight * line) + y_offset;
-
-            // Add the cell to the IsometricGrad object
-            isoGrid[xGrid][yGrid].x = x;
-            isoGrid[xGrid][yGrid].y = y;
-            isoGrid[xGrid][yGrid].cellType = WALKABLE;
-
-            // Alternate colors
-            if (grid % 2 == 0) {
-                SDL_SetRenderDrawColor(renderer, 0xAA, 0xAA, 0xAA, 0xFF);
-            } else {
-                SDL_SetRenderDrawColor(renderer, 0x55, 0x55, 0x55, 0xFF);
-            }
-
-            // Draw diamond
-            drawFilledDiamond(x, y, cellWidth, cellHeight);
-
-            // Draw outline
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-            drawDiamond(x, y, cellWidth, cellHeight);
+            float x = (cellWidth/2 * grid) + cellWidth;
+            float y = (cellHeight/2 * grid) + (cellHeight * line);
+            cells.push_back({x, y, WALKABLE, false});
         }
     }
 
-
-    std::cout << "-----" << std::endl;
-    std::cout << isoGrid[0][0].x << std::endl;
-    std::cout << cellHeight << std::endl;
-    isometricGrid.setCellWidth(cellWidth);
-    isometricGrid.setCellHeight(cellHeight);
-    isometricGrid.setViewportWidth(viewportWidth);
-    isometricGrid.setViewportHeight(viewportHeight);
+    isometricGrid.setFromScreenCells(cells, cellWidth, cellHeight);
+    layout.setGrid(isometricGrid);
+    mapEditor.resetJournal();
+    gridGeometryDirty = true;
 
     //To save the grid:
     if (JsonUtils::saveGridToJson(isometricGrid, "bleh.json")) 
@@ -492,8 +689,8 @@ void SDLResources::drawIsometricGridDefault() {
     float isoRatio = isometricGrid.getIsoRatio();
 
     // Get viewport dimensions
-    int viewportWidth = viewports[0].w;
-    int viewportHeight = viewports[0].h;
+    int viewportWidth = layout.getViewport(0).w;
+    int viewportHeight = layout.getViewport(0).h;
 
     // Calculate grid and viewport ratio
     float gridRatio = float(renderedGridWidth) / (renderedGridHeight);
@@ -0,0 +1,93 @@
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "soft_rasterizer.h"
+
+void SoftRasterizer::setTarget(void* buffer, int pitchBytes, int w, int h){
+    pixels = static_cast<uint32_t*>(buffer);
+    pitch = pitchBytes / static_cast<int>(sizeof(uint32_t));
+    width = w;
+    height = h;
+}
+
+void SoftRasterizer::clear(uint32_t color){
+    for (int row = 0; row < height; ++row) {
+        fillSpan(pixels + row * pitch, 0, width - 1, color);
+    }
+}
+
+// Wide unaligned stores, scalar loop for whatever is left.
+void SoftRasterizer::fillSpan(uint32_t* row, int x0, int x1, uint32_t color){
+    uint32_t* dst = row + x0;
+    int count = x1 - x0 + 1;
+
+#if defined(__AVX2__)
+    const __m256i wide = _mm256_set1_epi32(static_cast<int>(color));
+    for (; count >= 8; count -= 8, dst += 8) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), wide);
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i quad = _mm_set1_epi32(static_cast<int>(color));
+    for (; count >= 4; count -= 4, dst += 4) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), quad);
+    }
+#endif
+    for (; count > 0; --count) {
+        *dst++ = color;
+    }
+}
+
+void SoftRasterizer::fillDiamond(int x, int y, int w, int h, uint32_t fill, uint32_t outline){
+    if (pixels == nullptr || w <= 0 || h <= 0) {
+        return;
+    }
+
+    const int halfW = w / 2;
+    const int halfH = h / 2;
+
+    // Half width of the diamond at a given distance from the closest tip
+    auto halfWidthAt = [&](int i) {
+        return halfH > 0 ? (i * halfW) / halfH : halfW;
+    };
+
+    // Draw [x0, x1] clipped to the target
+    auto span = [&](uint32_t* row, int x0, int x1, uint32_t color) {
+        x0 = std::max(x0, 0);
+        x1 = std::min(x1, width - 1);
+        if (x0 <= x1) {
+            fillSpan(row, x0, x1, color);
+        }
+    };
+
+    const int firstRow = std::max(y, 0);
+    const int lastRow = std::min(y + h, height - 1);
+
+    for (int py = firstRow; py <= lastRow; ++py) {
+        const int dy = py - y;
+        const int i = std::min(dy, h - dy);
+        const int hw = halfWidthAt(i);
+        uint32_t* row = pixels + py * pitch;
+
+        // Tips are outline only
+        if (i == 0) {
+            span(row, x - hw, x + hw, outline);
+            continue;
+        }
+
+        // The edges move ~2px per row (2:1 iso ratio), the outline has to
+        // cover the whole step to stay connected like a drawn line would.
+        const int hwInner = halfWidthAt(i - 1);
+        const int leftEnd = std::max(x - hw, x - hwInner - 1);
+        const int rightStart = std::min(x + hw, x + hwInner + 1);
+
+        span(row, x - hw, leftEnd, outline);
+        span(row, leftEnd + 1, rightStart - 1, fill);
+        span(row, rightStart, x + hw, outline);
+    }
+}